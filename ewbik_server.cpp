@@ -0,0 +1,217 @@
+/*************************************************************************/
+/*  ewbik_server.cpp                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "ewbik_server.h"
+#include "core/os/os.h"
+#include "skeleton_modification_3d_ewbik.h"
+
+EWBIKServer *EWBIKServer::singleton = nullptr;
+
+EWBIKServer *EWBIKServer::get_singleton() {
+	return singleton;
+}
+
+RID EWBIKServer::rig_create(SkeletonModification3DEWBIK *p_modification) {
+	ERR_FAIL_NULL_V(p_modification, RID());
+	Rig *rig = memnew(Rig);
+	rig->modification = p_modification;
+	rig_count++;
+	return rig_owner.make_rid(rig);
+}
+
+void EWBIKServer::rig_free(RID p_rig) {
+	Rig *rig = rig_owner.getornull(p_rig);
+	ERR_FAIL_COND(!rig);
+	queued_rigs.erase(rig);
+	rig_owner.free(p_rig);
+	memdelete(rig);
+	rig_count--;
+}
+
+void EWBIKServer::rig_queue_solve(RID p_rig, real_t p_strength) {
+	Rig *rig = rig_owner.getornull(p_rig);
+	ERR_FAIL_COND(!rig);
+	rig->strength = p_strength;
+	if (rig->queued) {
+		return;
+	}
+	rig->queued = true;
+	queued_rigs.push_back(rig);
+	// All rigs executed this frame are solved together once the modification stacks are done,
+	// in the idle flush before the frame is drawn. Rigs with modifications after EWBIK flush it early.
+	if (!batch_scheduled) {
+		batch_scheduled = true;
+		call_deferred("solve_batch");
+	}
+}
+
+void EWBIKServer::solve_batch() {
+	batch_scheduled = false;
+	if (queued_rigs.is_empty()) {
+		// Already flushed by a rig whose stack goes on after it.
+		return;
+	}
+	uint64_t start_usec = OS::get_singleton()->get_ticks_usec();
+
+	// Gather reads the skeletons and targets, so it runs on the main thread.
+	batch.clear();
+	Vector<SkeletonModification3DEWBIK *> skipped;
+	for (int32_t rig_i = 0; rig_i < queued_rigs.size(); rig_i++) {
+		Rig *rig = queued_rigs[rig_i];
+		rig->queued = false;
+		if (rig->strength <= 0.01f) {
+			continue;
+		}
+		if (rig->modification->gather_solve(rig->strength)) {
+			batch.push_back(rig->modification);
+		} else {
+			skipped.push_back(rig->modification);
+		}
+	}
+	queued_rigs.clear();
+
+	// Every pack is a task. Rigs with parallel_solve add their roots and pinned subtrees as tasks
+	// that depend on their parent chain, and idle workers steal whatever is left.
+	build_packs();
+	IKTaskScheduler *scheduler = IKTaskScheduler::get_singleton();
+	if (scheduler) {
+		scheduler->begin_frame();
+		scheduler->run(&EWBIKServer::_solve_pack, packs.ptrw(), packs.size());
+		last_batch_stats = scheduler->end_frame();
+	} else {
+		for (int32_t pack_i = 0; pack_i < packs.size(); pack_i++) {
+			_solve_pack(packs.ptrw(), pack_i);
+		}
+		last_batch_stats = IKTaskScheduler::FrameStats();
+	}
+
+	for (int32_t rig_i = 0; rig_i < batch.size(); rig_i++) {
+		batch[rig_i]->scatter_solve(true);
+	}
+	for (int32_t rig_i = 0; rig_i < skipped.size(); rig_i++) {
+		skipped[rig_i]->scatter_solve(false);
+	}
+
+	last_batch_size = batch.size();
+	last_batch_pack_count = packs.size();
+	packs.clear();
+	last_batch_millisecond = (OS::get_singleton()->get_ticks_usec() - start_usec) / 1000.0;
+	batch.clear();
+}
+
+void EWBIKServer::build_packs() {
+	packs.clear();
+	open_packs.clear();
+	for (int32_t rig_i = 0; rig_i < batch.size(); rig_i++) {
+		SkeletonModification3DEWBIK *modification = batch[rig_i];
+		if (!modification->is_crowd_packable()) {
+			Pack pack;
+			pack.rigs[0] = modification;
+			pack.count = 1;
+			packs.push_back(pack);
+			continue;
+		}
+		uint32_t signature = modification->get_crowd_signature();
+		const int32_t *open = open_packs.getptr(signature);
+		if (!open) {
+			open_packs[signature] = packs.size();
+			packs.push_back(Pack());
+			open = open_packs.getptr(signature);
+		}
+		Pack &pack = packs.write[*open];
+		pack.rigs[pack.count++] = modification;
+		if (pack.count == QCPLanes::LANES) {
+			open_packs.erase(signature);
+		}
+	}
+	open_packs.clear();
+}
+
+void EWBIKServer::_solve_pack(void *p_packs, uint32_t p_index) {
+	// Packs share no state, so they don't depend on each other.
+	Pack &pack = ((Pack *)p_packs)[p_index];
+	if (pack.count == 1) {
+		pack.rigs[0]->solve_gathered();
+	} else {
+		SkeletonModification3DEWBIK::solve_gathered_lanes(pack.rigs, pack.count);
+	}
+}
+
+int32_t EWBIKServer::get_rig_count() const {
+	return rig_count;
+}
+
+int32_t EWBIKServer::get_last_batch_size() const {
+	return last_batch_size;
+}
+
+real_t EWBIKServer::get_last_batch_millisecond() const {
+	return last_batch_millisecond;
+}
+
+int32_t EWBIKServer::get_last_batch_pack_count() const {
+	return last_batch_pack_count;
+}
+
+int32_t EWBIKServer::get_last_batch_task_count() const {
+	return last_batch_stats.task_count;
+}
+
+int32_t EWBIKServer::get_last_batch_steal_count() const {
+	return last_batch_stats.steal_count;
+}
+
+real_t EWBIKServer::get_last_batch_utilization() const {
+	return last_batch_stats.utilization;
+}
+
+real_t EWBIKServer::get_last_batch_critical_path_millisecond() const {
+	return last_batch_stats.critical_path_millisecond;
+}
+
+void EWBIKServer::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("solve_batch"), &EWBIKServer::solve_batch);
+	ClassDB::bind_method(D_METHOD("get_rig_count"), &EWBIKServer::get_rig_count);
+	ClassDB::bind_method(D_METHOD("get_last_batch_size"), &EWBIKServer::get_last_batch_size);
+	ClassDB::bind_method(D_METHOD("get_last_batch_millisecond"), &EWBIKServer::get_last_batch_millisecond);
+	ClassDB::bind_method(D_METHOD("get_last_batch_pack_count"), &EWBIKServer::get_last_batch_pack_count);
+	ClassDB::bind_method(D_METHOD("get_last_batch_task_count"), &EWBIKServer::get_last_batch_task_count);
+	ClassDB::bind_method(D_METHOD("get_last_batch_steal_count"), &EWBIKServer::get_last_batch_steal_count);
+	ClassDB::bind_method(D_METHOD("get_last_batch_utilization"), &EWBIKServer::get_last_batch_utilization);
+	ClassDB::bind_method(D_METHOD("get_last_batch_critical_path_millisecond"), &EWBIKServer::get_last_batch_critical_path_millisecond);
+}
+
+EWBIKServer::EWBIKServer() {
+	singleton = this;
+}
+
+EWBIKServer::~EWBIKServer() {
+	singleton = nullptr;
+}
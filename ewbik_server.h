@@ -0,0 +1,106 @@
+/*************************************************************************/
+/*  ewbik_server.h                                                       */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef EWBIK_SERVER_H
+#define EWBIK_SERVER_H
+
+#include "core/object/class_db.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/rid_owner.h"
+#include "core/templates/vector.h"
+#include "ik_task_scheduler.h"
+#include "math/qcp_lanes.h"
+
+class SkeletonModification3DEWBIK;
+
+// Batches the solves of every registered rig into one job per frame. Scene reads and writes
+// stay on the main thread, only the solves themselves run on the worker threads.
+// The batch runs deferred, after every stack has executed but before the frame is drawn, so a
+// batched pose lands in the same frame. A rig whose stack has more modifications after EWBIK
+// solves the batch right away instead, since those modifications read its pose.
+class EWBIKServer : public Object {
+	GDCLASS(EWBIKServer, Object);
+
+	static EWBIKServer *singleton;
+
+	struct Rig {
+		SkeletonModification3DEWBIK *modification = nullptr;
+		real_t strength = 1.0;
+		bool queued = false;
+	};
+
+	RID_PtrOwner<Rig> rig_owner;
+	int32_t rig_count = 0;
+	Vector<Rig *> queued_rigs;
+	Vector<SkeletonModification3DEWBIK *> batch;
+
+	// Crowd rigs of the same signature share a pack and solve in its lanes, other rigs get a pack of one.
+	struct Pack {
+		SkeletonModification3DEWBIK *rigs[QCPLanes::LANES] = {};
+		int32_t count = 0;
+	};
+	Vector<Pack> packs;
+	HashMap<uint32_t, int32_t> open_packs;
+	bool batch_scheduled = false;
+
+	// Statistics of the last batch
+	int32_t last_batch_size = 0;
+	real_t last_batch_millisecond = 0.0;
+	int32_t last_batch_pack_count = 0;
+	IKTaskScheduler::FrameStats last_batch_stats;
+
+	void build_packs();
+	static void _solve_pack(void *p_packs, uint32_t p_index);
+
+protected:
+	static void _bind_methods();
+
+public:
+	static EWBIKServer *get_singleton();
+
+	RID rig_create(SkeletonModification3DEWBIK *p_modification);
+	void rig_free(RID p_rig);
+	void rig_queue_solve(RID p_rig, real_t p_strength);
+	void solve_batch();
+
+	int32_t get_rig_count() const;
+	int32_t get_last_batch_size() const;
+	real_t get_last_batch_millisecond() const;
+	int32_t get_last_batch_pack_count() const;
+	int32_t get_last_batch_task_count() const;
+	int32_t get_last_batch_steal_count() const;
+	real_t get_last_batch_utilization() const;
+	real_t get_last_batch_critical_path_millisecond() const;
+
+	EWBIKServer();
+	~EWBIKServer();
+};
+
+#endif // EWBIK_SERVER_H
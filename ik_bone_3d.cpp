@@ -74,6 +74,59 @@ bool IKBone3D::get_orientation_lock() const {
 	return orientation_lock;
 }
 
+void IKBone3D::set_frozen(bool p_frozen) {
+	frozen = p_frozen;
+}
+
+bool IKBone3D::is_frozen() const {
+	return frozen;
+}
+
+bool IKBone3D::is_rigid() const {
+	// Rigid bones ride along with their parent and are left out of the solve.
+	return orientation_lock || frozen || twist_driver.is_valid();
+}
+
+void IKBone3D::set_twist_driver(const Ref<IKBone3D> &p_driver, real_t p_fraction) {
+	twist_driver = p_driver;
+	twist_fraction = p_fraction;
+	twist_path_child = Ref<IKBone3D>();
+	// The child leading down to the driver, if the driver is a descendant.
+	Ref<IKBone3D> current_bone = p_driver;
+	while (current_bone.is_valid() && current_bone->get_parent().is_valid()) {
+		if (current_bone->get_parent() == this) {
+			twist_path_child = current_bone;
+			break;
+		}
+		current_bone = current_bone->get_parent();
+	}
+}
+
+Ref<IKBone3D> IKBone3D::get_twist_driver() const {
+	return twist_driver;
+}
+
+real_t IKBone3D::get_twist_fraction() const {
+	return twist_fraction;
+}
+
+void IKBone3D::update_twist() {
+	// Swing-twist split of the driver's solved rotation around its bone axis.
+	Quat rot = twist_driver->rot_delta.w < 0.0 ? -twist_driver->rot_delta : twist_driver->rot_delta;
+	real_t angle = 2.0 * Math::atan2(rot.y, rot.w);
+	Quat share = Quat(Vector3(0.0, 1.0, 0.0), angle * twist_fraction);
+	twist_adjustment = share;
+	if (twist_path_child.is_valid()) {
+		// The bones below would inherit the share, so the child on the path to the driver undoes it.
+		// The share is about this bone's axis, conjugated into the child's frame it cancels on any bent chain.
+		// Assumes the child sits on the twist axis, as it does for a roll bone.
+		Ref<IKBone3D> child = twist_path_child;
+		Quat child_rest = child->initial_transform.basis.get_rotation_quat();
+		Quat undo = child_rest.inverse() * share.inverse() * child_rest;
+		child->twist_adjustment = child->rot_delta.inverse() * undo * child->rot_delta * child->twist_adjustment;
+	}
+}
+
 void IKBone3D::set_global_transform(const Transform &p_transform) {
 	xform.set_global_transform(p_transform);
 }
@@ -88,20 +141,43 @@ void IKBone3D::set_rot_delta(const Quat &p_rot) {
 	set_global_transform(get_global_transform() * rot_xform);
 }
 
-void IKBone3D::set_initial_transform(Skeleton3D *p_skeleton) {
-	Transform bxform = p_skeleton->get_bone_global_pose(bone_id);
+void IKBone3D::set_initial_transform(const Transform &p_global_pose) {
+	Transform bxform = p_global_pose;
 	if (parent.is_valid()) {
 		bxform = parent->get_global_transform().affine_inverse() * bxform;
 	}
 	set_transform(bxform);
+	initial_transform = bxform;
 	if (is_effector()) {
-		effector->update_goal_transform(p_skeleton);
+		effector->update_goal_transform();
 	}
+	prev_rot_delta = rot_delta;
 	rot_delta = Quat();
+	twist_adjustment = Quat();
 }
 
-void IKBone3D::set_skeleton_bone_transform(Skeleton3D *p_skeleton, real_t p_strenght) {
-	Transform custom = Transform(Basis(rot_delta), Vector3());
+void IKBone3D::warm_start(real_t p_blend) {
+	// Must run after every bone got its initial transform, so children follow their seeded parents.
+	set_rot_delta(Quat().slerp(prev_rot_delta, p_blend));
+}
+
+bool IKBone3D::is_input_changed(real_t p_distance, real_t p_angle) const {
+	return !IKTransform::is_equal_within(initial_transform, solved_initial_transform, p_distance, p_angle);
+}
+
+void IKBone3D::mark_solved() {
+	solved_initial_transform = initial_transform;
+}
+
+Quat IKBone3D::get_solved_rotation() const {
+	return rot_delta * twist_adjustment;
+}
+
+void IKBone3D::set_skeleton_bone_transform(Skeleton3D *p_skeleton, const Quat &p_rotation, real_t p_strenght) {
+	if (frozen) {
+		return; // Keeps the input pose, its override was already reset.
+	}
+	Transform custom = Transform(Basis(p_rotation), Vector3());
 	p_skeleton->set_bone_local_pose_override(bone_id, custom, p_strenght, true);
 }
 
@@ -146,6 +222,8 @@ void IKBone3D::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_effector"), &IKBone3D::get_effector);
 	ClassDB::bind_method(D_METHOD("set_effector", "effector"), &IKBone3D::set_effector);
 	ClassDB::bind_method(D_METHOD("is_pinned"), &IKBone3D::is_effector);
+	ClassDB::bind_method(D_METHOD("set_frozen", "frozen"), &IKBone3D::set_frozen);
+	ClassDB::bind_method(D_METHOD("is_frozen"), &IKBone3D::is_frozen);
 }
 
 IKBone3D::IKBone3D(BoneId p_bone, const Ref<IKBone3D> &p_parent) {
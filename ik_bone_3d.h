@@ -44,11 +44,19 @@ class IKBone3D : public Reference {
 private:
 	BoneId bone_id = -1;
 	bool orientation_lock = false;
+	bool frozen = false;
 	Ref<IKBone3D> parent = nullptr;
 	Vector<Ref<IKBone3D>> children;
 	Ref<IKEffector3D> effector = nullptr;
 	IKTransform xform;
 	Quat rot_delta = Quat();
+	Quat prev_rot_delta = Quat();
+	Transform initial_transform;
+	Transform solved_initial_transform;
+	Ref<IKBone3D> twist_driver = nullptr;
+	real_t twist_fraction = 0.0;
+	Ref<IKBone3D> twist_path_child = nullptr;
+	Quat twist_adjustment = Quat();
 
 	static bool has_effector_descendant(BoneId p_bone, Skeleton3D *p_skeleton, const HashMap<BoneId, Ref<IKBone3D>> &p_map);
 
@@ -66,11 +74,22 @@ public:
 	Transform get_transform() const;
 	void set_orientation_lock(const bool p_lock);
 	bool get_orientation_lock() const;
+	void set_frozen(bool p_frozen);
+	bool is_frozen() const;
+	bool is_rigid() const;
+	void set_twist_driver(const Ref<IKBone3D> &p_driver, real_t p_fraction);
+	Ref<IKBone3D> get_twist_driver() const;
+	real_t get_twist_fraction() const;
+	void update_twist();
 	void set_global_transform(const Transform &p_transform);
 	void set_rot_delta(const Quat &p_rot);
 	Transform get_global_transform() const;
-	void set_initial_transform(Skeleton3D *p_skeleton);
-	void set_skeleton_bone_transform(Skeleton3D *p_skeleton, real_t p_strenght);
+	void set_initial_transform(const Transform &p_global_pose);
+	void warm_start(real_t p_blend);
+	bool is_input_changed(real_t p_distance, real_t p_angle) const;
+	void mark_solved();
+	Quat get_solved_rotation() const;
+	void set_skeleton_bone_transform(Skeleton3D *p_skeleton, const Quat &p_rotation, real_t p_strenght);
 	void create_effector();
 	bool is_effector() const;
 	Vector<BoneId> get_children_with_effector_descendants(Skeleton3D *p_skeleton, const HashMap<BoneId, Ref<IKBone3D>> &p_map) const;
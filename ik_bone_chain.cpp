@@ -30,6 +30,9 @@
 
 #include "ik_bone_chain.h"
 
+#include "core/templates/hashfuncs.h"
+#include "ik_task_scheduler.h"
+
 Ref<IKBone3D> IKBoneChain::get_root() const {
 	return root;
 }
@@ -45,6 +48,10 @@ bool IKBoneChain::is_tip_effector() const {
 	return tip->is_effector();
 }
 
+bool IKBoneChain::is_held() const {
+	return is_tip_effector() && tip->get_effector()->is_held();
+}
+
 Vector<Ref<IKBoneChain>> IKBoneChain::get_child_chains() const {
 	return child_chains;
 }
@@ -156,12 +163,12 @@ void IKBoneChain::generate_default_segments_from_root() {
 	update_segmented_skeleton();
 }
 
-Ref<IKBoneChain> IKBoneChain::get_child_segment_containing(const Ref<IKBone3D> &p_bone) {
+Ref<IKBoneChain> IKBoneChain::get_child_segment_containing(const Ref<IKBone3D> &p_bone) const {
 	if (bones_map.has(p_bone->get_bone_id())) {
-		return this;
+		return const_cast<IKBoneChain *>(this);
 	} else {
 		for (int32_t child_i = 0; child_i < child_chains.size(); child_i++) {
-			Ref<IKBoneChain> child_segment = child_chains.write[child_i]->get_child_segment_containing(p_bone);
+			Ref<IKBoneChain> child_segment = child_chains[child_i]->get_child_segment_containing(p_bone);
 			if (child_segment.is_valid())
 				return child_segment;
 		}
@@ -182,55 +189,325 @@ void IKBoneChain::get_bone_list(Vector<Ref<IKBone3D>> &p_list) const {
 	}
 }
 
-void IKBoneChain::update_effector_list() {
+void IKBoneChain::update_effector_list(real_t p_weight_threshold) {
+	effector_list.clear();
+	effector_falloffs.clear();
 	heading_weights.clear();
+	uncut_heading_count = 0;
 	real_t depth_falloff = is_tip_effector() ? tip->get_effector()->depth_falloff : 1.0;
 	for (int32_t chain_i = 0; chain_i < child_chains.size(); chain_i++) {
 		Ref<IKBoneChain> chain = child_chains[chain_i];
-		chain->update_effector_list();
-		if (depth_falloff > CMP_EPSILON) {
-			effector_list.append_array(chain->effector_list);
-			for (int32_t w_i = 0; w_i < chain->heading_weights.size(); w_i++) {
-				heading_weights.push_back(chain->heading_weights[w_i] * depth_falloff);
+		chain->update_effector_list(p_weight_threshold);
+		if (depth_falloff <= CMP_EPSILON) {
+			continue;
+		}
+		uncut_heading_count += chain->uncut_heading_count;
+		// Effectors whose falloff product got negligible on the way up cost headings here without moving anything.
+		for (int32_t effector_i = 0; effector_i < chain->effector_list.size(); effector_i++) {
+			real_t falloff = chain->effector_falloffs[effector_i] * depth_falloff;
+			if (falloff < p_weight_threshold) {
+				continue;
 			}
+			effector_list.push_back(chain->effector_list[effector_i]);
+			effector_falloffs.push_back(falloff);
+			heading_weights.push_back(chain->heading_weights[effector_i * 2] * depth_falloff);
+			heading_weights.push_back(chain->heading_weights[effector_i * 2 + 1] * depth_falloff);
 		}
 	}
 	if (is_tip_effector()) {
 		Ref<IKEffector3D> effector = tip->get_effector();
 		effector_list.push_back(effector);
+		effector_falloffs.push_back(1.0);
 		heading_weights.push_back(effector->weight);
 		heading_weights.push_back(effector->weight);
+		uncut_heading_count += 2;
 	}
 	create_headings();
+	update_reach();
+	update_solve_bones();
+
+	pinned_subtrees.clear();
+	for (int32_t i = 0; i < effector_direct_descendents.size(); i++) {
+		pinned_subtrees.append_array(effector_direct_descendents[i]->child_chains);
+	}
+}
+
+void IKBoneChain::update_solve_bones() {
+	// Locked and frozen bones keep their pose relative to the parent, so they are compiled out of the solve.
+	solve_bones.clear();
+	bone_count = 0;
+	Ref<IKBone3D> current_bone = tip;
+	while (current_bone.is_valid()) {
+		bone_count++;
+		if (!current_bone->is_rigid()) {
+			solve_bones.push_back(current_bone);
+		}
+		if (current_bone == root) {
+			break;
+		}
+		current_bone = current_bone->get_parent();
+	}
+}
+
+void IKBoneChain::update_heading_weights() {
+	// Runtime weight changes rewrite the compiled slots in place, so toggling effectors never reallocates.
+	active = false;
+	for (int32_t effector_i = 0; effector_i < effector_list.size(); effector_i++) {
+		Ref<IKEffector3D> effector = effector_list[effector_i];
+		real_t w = effector->active ? effector->gathered_weight * effector_falloffs[effector_i] : 0.0;
+		heading_weights.write[effector_i * 2] = w;
+		heading_weights.write[effector_i * 2 + 1] = w;
+		active = active || w > 0.0;
+	}
+	if (is_tip_effector()) {
+		tip->get_effector()->update_heading_weights(heading_weights);
+	}
+	for (int32_t child_i = 0; child_i < child_chains.size(); child_i++) {
+		child_chains.write[child_i]->update_heading_weights();
+	}
+}
+
+void IKBoneChain::update_solver_backend(IKSolverBackend::Type p_default) {
+	// An effector can pick the backend of the chain it ends, the rest of the rig keeps the default.
+	solver_backend = p_default;
+	if (is_tip_effector() && tip->get_effector()->get_solver_backend() >= 0) {
+		solver_backend = IKSolverBackend::Type(tip->get_effector()->get_solver_backend());
+	}
+	for (int32_t child_i = 0; child_i < child_chains.size(); child_i++) {
+		child_chains.write[child_i]->update_solver_backend(p_default);
+	}
+}
+
+void IKBoneChain::get_heading_counts(Dictionary &r_report) const {
+	// Every bone of a chain is solved against the same heading set.
+	Ref<IKBone3D> current_bone = tip;
+	while (current_bone.is_valid()) {
+		r_report[skeleton->get_bone_name(current_bone->get_bone_id())] = Vector2i(uncut_heading_count, heading_weights.size());
+		if (current_bone == root) {
+			break;
+		}
+		current_bone = current_bone->get_parent();
+	}
+	for (int32_t child_i = 0; child_i < child_chains.size(); child_i++) {
+		child_chains[child_i]->get_heading_counts(r_report);
+	}
+}
+
+void IKBoneChain::update_reach() {
+	// The chain can only pivot around its root, so the tip never gets further away than the summed rest offsets.
+	reach = -1.0;
+	if (!is_tip_effector()) {
+		return;
+	}
+	reach = 0.0;
+	Ref<IKBone3D> current_bone = tip;
+	while (current_bone.is_valid() && current_bone != root) {
+		reach += skeleton->get_bone_rest(current_bone->get_bone_id()).origin.length();
+		current_bone = current_bone->get_parent();
+	}
+	tip->get_effector()->reach = reach;
+}
+
+real_t IKBoneChain::get_reach() const {
+	return reach;
+}
+
+bool IKBoneChain::is_reachable() const {
+	if (reach < 0.0) {
+		return true;
+	}
+	Vector3 goal = tip->get_effector()->get_goal_transform().origin;
+	return root->get_global_transform().origin.distance_to(goal) <= reach + CMP_EPSILON;
+}
+
+void IKBoneChain::update_dirty(real_t p_distance, real_t p_angle, bool p_force, bool p_parent_input_dirty) {
+	// Moving input poses drag every descendant along, so input changes propagate down.
+	input_dirty = p_force || p_parent_input_dirty;
+	Ref<IKBone3D> current_bone = tip;
+	while (!input_dirty && current_bone.is_valid()) {
+		input_dirty = current_bone->is_input_changed(p_distance, p_angle);
+		if (current_bone == root) {
+			break;
+		}
+		current_bone = current_bone->get_parent();
+	}
+
+	for (int32_t child_i = 0; child_i < child_chains.size(); child_i++) {
+		child_chains.write[child_i]->update_dirty(p_distance, p_angle, p_force, input_dirty);
+	}
+
+	// Effectors propagate up to every chain that carries their headings, which stops at zero falloff pins.
+	// A held effector leaves its chain as it was, but remembers that it owes a solve.
+	if (is_tip_effector()) {
+		Ref<IKEffector3D> effector = tip->get_effector();
+		bool changed = input_dirty || effector->is_goal_changed(p_distance, p_angle);
+		effector->dirty = changed && !effector->held;
+		effector->deferred = changed && effector->held;
+	}
+	dirty = input_dirty;
+	for (int32_t effector_i = 0; !dirty && effector_i < effector_list.size(); effector_i++) {
+		dirty = effector_list[effector_i]->dirty;
+	}
+	dirty = dirty && !is_held();
+}
+
+void IKBoneChain::propagate_dirty(bool p_parent_dirty) {
+	// Re-solving a chain moves all its descendants, so they can't keep their cached rotations either.
+	dirty = (dirty || p_parent_dirty) && !is_held();
+	if (is_tip_effector()) {
+		Ref<IKEffector3D> effector = tip->get_effector();
+		effector->dirty = dirty;
+		effector->deferred = effector->deferred || (effector->held && p_parent_dirty);
+	}
+	for (int32_t child_i = 0; child_i < child_chains.size(); child_i++) {
+		child_chains.write[child_i]->propagate_dirty(dirty);
+	}
+}
+
+void IKBoneChain::seed_rotations(real_t p_warm_start_blend) {
+	// Clean chains get their cached solution back in full, dirty ones only when warm starting.
+	real_t blend = dirty ? p_warm_start_blend : 1.0;
+	Ref<IKBone3D> current_bone = tip;
+	while (blend > 0.0 && current_bone.is_valid()) {
+		current_bone->warm_start(blend);
+		if (current_bone == root) {
+			break;
+		}
+		current_bone = current_bone->get_parent();
+	}
+	for (int32_t child_i = 0; child_i < child_chains.size(); child_i++) {
+		child_chains.write[child_i]->seed_rotations(p_warm_start_blend);
+	}
+}
+
+void IKBoneChain::mark_solved() {
+	Ref<IKBone3D> current_bone = tip;
+	while (dirty && current_bone.is_valid()) {
+		current_bone->mark_solved();
+		if (current_bone == root) {
+			break;
+		}
+		current_bone = current_bone->get_parent();
+	}
+	if (dirty && is_tip_effector()) {
+		Ref<IKEffector3D> effector = tip->get_effector();
+		effector->solved_goal_transform = effector->goal_transform;
+	}
+	for (int32_t child_i = 0; child_i < child_chains.size(); child_i++) {
+		child_chains.write[child_i]->mark_solved();
+	}
+}
+
+void IKBoneChain::solve_unreachable(bool p_parent_dirty) {
+	// Only a chain that serves a single effector and whose root stays put this frame has a closed-form answer.
+	straightened = false;
+	if (dirty && active && !p_parent_dirty && is_tip_effector() && effector_list.size() == 1 && !is_reachable()) {
+		straightened = straighten();
+	}
+	if (is_tip_effector()) {
+		tip->get_effector()->unreachable = straightened;
+	}
+	for (int32_t child_i = 0; child_i < child_chains.size(); child_i++) {
+		child_chains.write[child_i]->solve_unreachable(dirty);
+	}
+}
+
+bool IKBoneChain::straighten() {
+	Vector<Ref<IKBone3D>> bones;
+	Ref<IKBone3D> current_bone = tip;
+	while (current_bone != root) {
+		current_bone = current_bone->get_parent();
+		if (current_bone->is_rigid()) {
+			return false;
+		}
+		bones.push_back(current_bone);
+	}
+
+	// From the root down, every bone points its child at the goal, which leaves the whole chain on one line.
+	Ref<IKEffector3D> effector = tip->get_effector();
+	Vector3 goal = effector->get_goal_transform().origin;
+	for (int32_t bone_i = bones.size() - 1; bone_i >= 0; bone_i--) {
+		Ref<IKBone3D> bone = bones[bone_i];
+		Ref<IKBone3D> next = bone_i > 0 ? bones[bone_i - 1] : tip;
+		Transform global = bone->get_global_transform();
+		Vector3 to_next = next->get_global_transform().origin - global.origin;
+		Vector3 to_goal = goal - global.origin;
+		if (to_next.length_squared() < CMP_EPSILON2 || to_goal.length_squared() < CMP_EPSILON2) {
+			continue;
+		}
+		Quat rot = Quat(to_next.normalized(), to_goal.normalized());
+		Quat basis_rot = global.basis.get_rotation_quat();
+		bone->set_rot_delta(basis_rot.inverse() * rot * basis_rot);
+	}
+
+	if (!tip->is_rigid() && !effector->is_following_translation_only()) {
+		update_optimal_rotation(tip, 0, 1.0);
+	}
+	return true;
 }
 
-void IKBoneChain::update_optimal_rotation(Ref<IKBone3D> p_for_bone, int32_t p_stabilization_passes) {
+void IKBoneChain::update_optimal_rotation(Ref<IKBone3D> p_for_bone, int32_t p_stabilization_passes, real_t p_relaxation) {
 	if (p_for_bone->get_parent().is_null() || (child_chains.is_empty() && tip->get_effector()->is_following_translation_only())) {
 		p_stabilization_passes = 0;
 	}
 
 	Vector<real_t> *weights = nullptr;
 	PackedVector3Array *htarget = update_target_headings(p_for_bone, weights);
+	PackedVector3Array *htip = update_tip_headings(p_for_bone);
 
-	real_t sqrmsd = MAXFLOAT;
-	for (int32_t i = 0; i < p_stabilization_passes + 1; i++) {
-		PackedVector3Array *htip = update_tip_headings(p_for_bone);
+	if (p_stabilization_passes == 0) {
+		set_optimal_rotation(p_for_bone, *htarget, *htip, *weights, p_relaxation);
+		return;
+	}
 
-		real_t new_sqrmsd = set_optimal_rotation(p_for_bone, *htarget, *htip, *weights);
-		if (new_sqrmsd <= sqrmsd) {
+	// Each pass is measured against the real headings after it has been applied, and undone if it didn't help.
+	real_t sqrmsd = get_manual_sqrmsd(*htip, *htarget, *weights);
+	for (int32_t i = 0; i < p_stabilization_passes + 1; i++) {
+		Quat rot = set_optimal_rotation(p_for_bone, *htarget, *htip, *weights, p_relaxation);
+		htip = update_tip_headings(p_for_bone);
+		real_t new_sqrmsd = get_manual_sqrmsd(*htip, *htarget, *weights);
+		if (new_sqrmsd >= sqrmsd) {
 			// TODO: Consider springy bones
+			p_for_bone->set_rot_delta(rot.inverse());
 			break;
 		}
 		sqrmsd = new_sqrmsd;
 	}
 }
 
-real_t IKBoneChain::set_optimal_rotation(Ref<IKBone3D> p_for_bone, const PackedVector3Array &p_htarget,
-		const PackedVector3Array &p_htip, const Vector<real_t> &p_weights) {
+real_t IKBoneChain::get_manual_sqrmsd(const PackedVector3Array &p_htip, const PackedVector3Array &p_htarget,
+		const Vector<real_t> &p_weights) const {
+	real_t sqrmsd = 0.0;
+	real_t wsum = 0.0;
+	for (int32_t i = 0; i < p_weights.size(); i++) {
+		real_t w = p_weights[i];
+		sqrmsd += w * p_htip[i].distance_squared_to(p_htarget[i]);
+		wsum += w;
+	}
+	return wsum > 0.0 ? sqrmsd / wsum : 0.0;
+}
+
+Quat IKBoneChain::set_optimal_rotation(Ref<IKBone3D> p_for_bone, const PackedVector3Array &p_htarget,
+		const PackedVector3Array &p_htip, const Vector<real_t> &p_weights, real_t p_relaxation) {
 	Quat rot;
-	real_t sqrmsd = qcp.calc_optimal_rotation(p_htip, p_htarget, p_weights, rot);
+	qcp.calc_optimal_rotation(p_htip, p_htarget, p_weights, rot);
+	if (p_relaxation != 1.0) {
+		rot = scale_rotation(rot, p_relaxation);
+	}
 	p_for_bone->set_rot_delta(rot);
-	return sqrmsd;
+	return rot;
+}
+
+Quat IKBoneChain::scale_rotation(const Quat &p_rot, real_t p_factor) {
+	// Take the short way around before scaling, so over-relaxation never flips the bone.
+	Quat rot = p_rot.w < 0.0 ? -p_rot : p_rot;
+	real_t sin_half = Math::sqrt(MAX(1.0 - rot.w * rot.w, 0.0));
+	if (sin_half < CMP_EPSILON) {
+		return rot;
+	}
+	Vector3 axis = Vector3(rot.x, rot.y, rot.z) / sin_half;
+	real_t angle = 2.0 * Math::acos(CLAMP(rot.w, -1.0, 1.0));
+	return Quat(axis, angle * p_factor);
 }
 
 void IKBoneChain::create_headings() {
@@ -280,41 +557,274 @@ PackedVector3Array* IKBoneChain::update_tip_headings(Ref<IKBone3D> p_for_bone) {
 	return htip;
 }
 
-void IKBoneChain::grouped_segment_solver(int32_t p_stabilization_passes) {
-	segment_solver(p_stabilization_passes);
-	for (int32_t i = 0; i < effector_direct_descendents.size(); i++) {
-		Ref<IKBoneChain> effector_chain = effector_direct_descendents[i];
-		for (int32_t child_i = 0; child_i < effector_chain->child_chains.size(); child_i++) {
-			Ref<IKBoneChain> child = effector_chain->child_chains[child_i];
-			child->grouped_segment_solver(p_stabilization_passes);
+void IKBoneChain::grouped_segment_solver(int32_t p_stabilization_passes, real_t p_relaxation, int32_t p_coarse_bones, bool p_parallel) {
+	segment_solver(p_stabilization_passes, p_relaxation, p_coarse_bones);
+
+	// Pinned subtrees depend on this chain only, so they become tasks once it is solved.
+	IKTaskScheduler *scheduler = IKTaskScheduler::get_singleton();
+	if (p_parallel && scheduler && pinned_subtrees.size() > 1) {
+		// Subtrees only read the transforms of the tips they hang off. Evaluating them up front
+		// keeps the lazy global transform cache from being written by several workers at once.
+		for (int32_t i = 0; i < effector_direct_descendents.size(); i++) {
+			effector_direct_descendents[i]->tip->get_global_transform();
 		}
+		SubtreeWork work;
+		work.chain = this;
+		work.stabilization_passes = p_stabilization_passes;
+		work.relaxation = p_relaxation;
+		work.coarse_bones = p_coarse_bones;
+		scheduler->run(&IKBoneChain::_solve_subtree, &work, pinned_subtrees.size());
+		return;
 	}
+	for (int32_t subtree_i = 0; subtree_i < pinned_subtrees.size(); subtree_i++) {
+		pinned_subtrees.write[subtree_i]->grouped_segment_solver(p_stabilization_passes, p_relaxation, p_coarse_bones);
+	}
+}
+
+void IKBoneChain::_solve_subtree(void *p_work, uint32_t p_index) {
+	// Every subtree owns its bones, headings and QCP scratch, so the result doesn't depend on scheduling.
+	SubtreeWork *work = (SubtreeWork *)p_work;
+	work->chain->pinned_subtrees.write[p_index]->grouped_segment_solver(work->stabilization_passes, work->relaxation, work->coarse_bones, true);
 }
 
-void IKBoneChain::segment_solver(int32_t p_stabilization_passes) {
-	if (child_chains.size() == 0 && !is_tip_effector()) {
+static int32_t get_first_lane(uint32_t p_mask) {
+	int32_t lane = 0;
+	while (!(p_mask & (1 << lane))) {
+		lane++;
+	}
+	return lane;
+}
+
+void IKBoneChain::grouped_segment_solver_lanes(IKBoneChain *const *p_chains, uint32_t p_mask, const real_t *p_relaxation) {
+	// The chains of every lane have the same shape, so they are walked together. Lanes in p_mask
+	// get the same steps as grouped_segment_solver without stabilization passes or coarse groups.
+	if (!p_mask) {
+		return;
+	}
+	segment_solver_lanes(p_chains, p_mask, p_relaxation);
+	IKBoneChain *lead = p_chains[get_first_lane(p_mask)];
+	IKBoneChain *subtrees[QCPLanes::LANES] = {};
+	for (int32_t subtree_i = 0; subtree_i < lead->pinned_subtrees.size(); subtree_i++) {
+		for (int32_t lane = 0; lane < QCPLanes::LANES; lane++) {
+			subtrees[lane] = (p_mask & (1 << lane)) ? p_chains[lane]->pinned_subtrees[subtree_i].ptr() : nullptr;
+		}
+		grouped_segment_solver_lanes(subtrees, p_mask, p_relaxation);
+	}
+}
+
+void IKBoneChain::segment_solver_lanes(IKBoneChain *const *p_chains, uint32_t p_mask, const real_t *p_relaxation) {
+	uint32_t mask = 0;
+	int32_t passes[QCPLanes::LANES] = {};
+	int32_t max_passes = 0;
+	for (int32_t lane = 0; lane < QCPLanes::LANES; lane++) {
+		IKBoneChain *chain = p_chains[lane];
+		if (!(p_mask & (1 << lane)) || !chain->dirty || chain->straightened || (chain->child_chains.size() == 0 && !chain->is_tip_effector())) {
+			continue;
+		}
+		mask |= 1 << lane;
+		passes[lane] = chain->active ? chain->get_scheduled_passes() : 0;
+		max_passes = MAX(max_passes, passes[lane]);
+	}
+	if (!mask) {
+		return;
+	}
+	IKBoneChain *lead = p_chains[get_first_lane(mask)];
+	if (!lead->is_tip_effector()) {
+		IKBoneChain *children[QCPLanes::LANES] = {};
+		for (int32_t child_i = 0; child_i < lead->child_chains.size(); child_i++) {
+			for (int32_t lane = 0; lane < QCPLanes::LANES; lane++) {
+				children[lane] = (mask & (1 << lane)) ? p_chains[lane]->child_chains[child_i].ptr() : nullptr;
+			}
+			segment_solver_lanes(children, mask, p_relaxation);
+		}
+	}
+	// Lanes that scheduled fewer passes drop out of the later ones.
+	for (int32_t pass_i = 0; pass_i < max_passes; pass_i++) {
+		uint32_t pass_mask = 0;
+		for (int32_t lane = 0; lane < QCPLanes::LANES; lane++) {
+			if ((mask & (1 << lane)) && pass_i < passes[lane]) {
+				pass_mask |= 1 << lane;
+			}
+		}
+		for (int32_t bone_i = 0; bone_i < lead->solve_bones.size(); bone_i++) {
+			qcp_solver_lanes(p_chains, pass_mask, bone_i, p_relaxation);
+		}
+	}
+}
+
+void IKBoneChain::qcp_solver_lanes(IKBoneChain *const *p_chains, uint32_t p_mask, int32_t p_bone_i, const real_t *p_relaxation) {
+	IKBoneChain *lead = p_chains[get_first_lane(p_mask)];
+	// Forward kinematics and the headings stay per lane, they are transposed into the lanes here.
+	uint32_t mask = 0;
+	int32_t count = -1;
+	for (int32_t lane = 0; lane < QCPLanes::LANES; lane++) {
+		if (!(p_mask & (1 << lane))) {
+			continue;
+		}
+		IKBoneChain *chain = p_chains[lane];
+		Ref<IKBone3D> bone = chain->solve_bones[p_bone_i];
+		Vector<real_t> *weights = nullptr;
+		const PackedVector3Array *htarget = chain->update_target_headings(bone, weights);
+		const PackedVector3Array *htip = chain->update_tip_headings(bone);
+		if (count == -1) {
+			count = weights->size();
+		}
+		if (weights->size() != count) {
+			// Effectors following translation only carry fewer headings, such a lane takes the scalar step.
+			chain->set_optimal_rotation(bone, *htarget, *htip, *weights, p_relaxation[lane]);
+			continue;
+		}
+		if (lead->lane_weights.size() != uint32_t(count)) {
+			// Zeroed, so lanes that never held data don't feed garbage through the kernel.
+			lead->lane_tip_headings.resize(count);
+			lead->lane_target_headings.resize(count);
+			lead->lane_weights.resize(count);
+			memset(lead->lane_tip_headings.ptr(), 0, sizeof(QCPLanes::Heading) * count);
+			memset(lead->lane_target_headings.ptr(), 0, sizeof(QCPLanes::Heading) * count);
+			memset(lead->lane_weights.ptr(), 0, sizeof(QCPLanes::Weight) * count);
+		}
+		for (int32_t i = 0; i < count; i++) {
+			QCPLanes::Heading &tip_heading = lead->lane_tip_headings[i];
+			QCPLanes::Heading &target_heading = lead->lane_target_headings[i];
+			tip_heading.x[lane] = (*htip)[i].x;
+			tip_heading.y[lane] = (*htip)[i].y;
+			tip_heading.z[lane] = (*htip)[i].z;
+			target_heading.x[lane] = (*htarget)[i].x;
+			target_heading.y[lane] = (*htarget)[i].y;
+			target_heading.z[lane] = (*htarget)[i].z;
+			lead->lane_weights[i].w[lane] = (*weights)[i];
+		}
+		mask |= 1 << lane;
+	}
+
+	Quat rot[QCPLanes::LANES];
+	lead->lane_qcp.calc_optimal_rotations(lead->lane_tip_headings.ptr(), lead->lane_target_headings.ptr(),
+			lead->lane_weights.ptr(), count, mask, rot);
+	for (int32_t lane = 0; lane < QCPLanes::LANES; lane++) {
+		if (!(mask & (1 << lane))) {
+			continue;
+		}
+		Quat lane_rot = rot[lane];
+		if (p_relaxation[lane] != 1.0) {
+			lane_rot = scale_rotation(lane_rot, p_relaxation[lane]);
+		}
+		p_chains[lane]->solve_bones[p_bone_i]->set_rot_delta(lane_rot);
+	}
+}
+
+bool IKBoneChain::is_lane_compatible() const {
+	// The lanes only run plain QCP steps.
+	if (solver_backend != IKSolverBackend::TYPE_QCP) {
+		return false;
+	}
+	for (int32_t chain_i = 0; chain_i < child_chains.size(); chain_i++) {
+		if (!child_chains[chain_i]->is_lane_compatible()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+uint32_t IKBoneChain::hash_layout(uint32_t p_hash) const {
+	// Everything the lanes index by position: solve lists, child chains and pinned subtrees.
+	uint32_t hash = hash_djb2_one_32(solve_bones.size(), p_hash);
+	hash = hash_djb2_one_32(is_tip_effector(), hash);
+	hash = hash_djb2_one_32(child_chains.size(), hash);
+	hash = hash_djb2_one_32(pinned_subtrees.size(), hash);
+	for (int32_t chain_i = 0; chain_i < child_chains.size(); chain_i++) {
+		hash = child_chains[chain_i]->hash_layout(hash);
+	}
+	return hash;
+}
+
+bool IKBoneChain::is_layout_equal(const IKBoneChain *p_other) const {
+	if (solve_bones.size() != p_other->solve_bones.size() || is_tip_effector() != p_other->is_tip_effector() ||
+			child_chains.size() != p_other->child_chains.size() || pinned_subtrees.size() != p_other->pinned_subtrees.size()) {
+		return false;
+	}
+	for (int32_t chain_i = 0; chain_i < child_chains.size(); chain_i++) {
+		if (!child_chains[chain_i]->is_layout_equal(p_other->child_chains[chain_i].ptr())) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void IKBoneChain::segment_solver(int32_t p_stabilization_passes, real_t p_relaxation, int32_t p_coarse_bones) {
+	if (!dirty || straightened || (child_chains.size() == 0 && !is_tip_effector())) {
 		return;
 	} else if (!is_tip_effector()) {
 		for (int32_t child_i = 0; child_i < child_chains.size(); child_i++) {
 			Ref<IKBoneChain> child = child_chains[child_i];
-			child->segment_solver(p_stabilization_passes);
+			child->segment_solver(p_stabilization_passes, p_relaxation, p_coarse_bones);
+		}
+	}
+	// A chain with all of its effectors off would only feed QCP zero weights.
+	int32_t passes = active ? get_scheduled_passes() : 0;
+	for (int32_t pass_i = 0; pass_i < passes; pass_i++) {
+		if (p_coarse_bones > 1) {
+			coarse_qcp_solver(p_coarse_bones, p_relaxation);
+		} else {
+			IKSolverBackend::get_backend(solver_backend)->solve(*this, p_stabilization_passes, p_relaxation);
 		}
 	}
-	qcp_solver(p_stabilization_passes);
 }
 
-void IKBoneChain::qcp_solver(int32_t p_stabilization_passes) {
-	Ref<IKBone3D> current_bone = tip;
-	while (current_bone.is_valid()) {
-		if (!current_bone->get_orientation_lock()) {
-			update_optimal_rotation(current_bone, p_stabilization_passes);
+int32_t IKBoneChain::get_scheduled_passes() const {
+	// A chain is solved as often as its most demanding effector asks for, and skipped once all have converged.
+	int32_t passes = 0;
+	for (int32_t effector_i = 0; effector_i < effector_list.size(); effector_i++) {
+		passes = MAX(passes, effector_list[effector_i]->scheduled_passes);
+	}
+	return passes;
+}
+
+void IKBoneChain::qcp_solver(int32_t p_stabilization_passes, real_t p_relaxation) {
+	for (int32_t bone_i = 0; bone_i < solve_bones.size(); bone_i++) {
+		update_optimal_rotation(solve_bones[bone_i], p_stabilization_passes, p_relaxation);
+	}
+}
+
+void IKBoneChain::coarse_qcp_solver(int32_t p_coarse_bones, real_t p_relaxation) {
+	// Runs of p_coarse_bones bones act as one virtual bone pivoting at the top of the run.
+	// Its rotation is then shared out evenly, which bends the run instead of turning it rigidly.
+	Ref<IKBone3D> group_tip = tip;
+	while (group_tip.is_valid()) {
+		Ref<IKBone3D> group_top = group_tip;
+		int32_t free_bones = group_top->is_rigid() ? 0 : 1;
+		for (int32_t bone_i = 1; bone_i < p_coarse_bones && group_top != root; bone_i++) {
+			group_top = group_top->get_parent();
+			free_bones += group_top->is_rigid() ? 0 : 1;
 		}
 
-		if (current_bone == root) {
-			break;
+		if (free_bones) {
+			Vector<real_t> *weights = nullptr;
+			PackedVector3Array *htarget = update_target_headings(group_top, weights);
+			PackedVector3Array *htip = update_tip_headings(group_top);
+			Quat rot;
+			qcp.calc_optimal_rotation(*htip, *htarget, *weights, rot);
+			Quat top_rot = group_top->get_global_transform().basis.get_rotation_quat();
+			Quat share = scale_rotation(top_rot * rot * top_rot.inverse(), p_relaxation / free_bones);
+
+			// Rotations about the members' own origins commute with the order they are applied in,
+			// so walking up from the group tip gives the same pose as walking down.
+			Ref<IKBone3D> current_bone = group_tip;
+			while (true) {
+				if (!current_bone->is_rigid()) {
+					Quat bone_rot = current_bone->get_global_transform().basis.get_rotation_quat();
+					current_bone->set_rot_delta(bone_rot.inverse() * share * bone_rot);
+				}
+				if (current_bone == group_top) {
+					break;
+				}
+				current_bone = current_bone->get_parent();
+			}
 		}
 
-		current_bone = current_bone->get_parent();
+		if (group_top == root) {
+			break;
+		}
+		group_tip = group_top->get_parent();
 	}
 }
 
@@ -375,6 +885,8 @@ void IKBoneChain::debug_print_chains(Vector<bool> p_levels) {
 void IKBoneChain::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("is_root_pinned"), &IKBoneChain::is_root_pinned);
 	ClassDB::bind_method(D_METHOD("is_tip_effector"), &IKBoneChain::is_tip_effector);
+	ClassDB::bind_method(D_METHOD("get_reach"), &IKBoneChain::get_reach);
+	ClassDB::bind_method(D_METHOD("is_reachable"), &IKBoneChain::is_reachable);
 }
 
 IKBoneChain::IKBoneChain(Skeleton3D *p_skeleton, BoneId p_root_bone, const Ref<IKBoneChain> &p_parent) {
@@ -33,43 +33,81 @@
 
 #include "core/object/reference.h"
 #include "ik_bone_3d.h"
+#include "ik_solver_backend.h"
 #include "math/qcp.h"
+#include "math/qcp_lanes.h"
 #include "scene/3d/skeleton_3d.h"
 
 class IKBoneChain : public Reference {
 	GDCLASS(IKBoneChain, Reference);
+	friend class IKSolverBackend;
 
 private:
 	Ref<IKBone3D> root;
 	Ref<IKBone3D> tip;
 	Vector<Ref<IKBoneChain>> child_chains; // Contains only direct child chains that end with effectors or have child that end with effectors
 	Vector<Ref<IKBoneChain>> effector_direct_descendents;
+	Vector<Ref<IKBoneChain>> pinned_subtrees; // Child chains of effector_direct_descendents, independent of each other
 	HashMap<BoneId, Ref<IKBone3D>> bones_map;
 	Ref<IKBoneChain> parent_chain;
 	Vector<Ref<IKEffector3D>> effector_list;
+	Vector<real_t> effector_falloffs; // Product of the depth falloffs between each effector and this chain
+	int32_t uncut_heading_count = 0;
+	bool active = true; // Whether any effector in effector_list has weight left
+	Vector<Ref<IKBone3D>> solve_bones; // Tip to root, without rigid bones
+	int32_t bone_count = 0;
+	IKSolverBackend::Type solver_backend = IKSolverBackend::TYPE_QCP;
+	PackedVector3Array solver_points;
 	PackedVector3Array target_headings;
 	PackedVector3Array tip_headings;
 	Vector<real_t> heading_weights;
 	int32_t idx_eff_i = -1, idx_eff_f = -1;
+	bool input_dirty = true;
+	bool dirty = true;
+	real_t reach = -1.0;
+	bool straightened = false;
 
 	Skeleton3D *skeleton = nullptr;
 	QCP qcp;
 
+	struct SubtreeWork {
+		IKBoneChain *chain = nullptr;
+		int32_t stabilization_passes = 0;
+		real_t relaxation = 1.0;
+		int32_t coarse_bones = 1;
+	};
+	static void _solve_subtree(void *p_work, uint32_t p_index);
+
+	// Lane scratch, used while this chain leads a pack of identical chains.
+	QCPLanes lane_qcp;
+	LocalVector<QCPLanes::Heading> lane_tip_headings;
+	LocalVector<QCPLanes::Heading> lane_target_headings;
+	LocalVector<QCPLanes::Weight> lane_weights;
+
+	static void segment_solver_lanes(IKBoneChain *const *p_chains, uint32_t p_mask, const real_t *p_relaxation);
+	static void qcp_solver_lanes(IKBoneChain *const *p_chains, uint32_t p_mask, int32_t p_bone_i, const real_t *p_relaxation);
+
 	BoneId find_root_bone_id(BoneId p_bone);
 	void generate_skeleton_segments(const HashMap<BoneId, Ref<IKBone3D>> &p_map);
 	void update_segmented_skeleton();
 	void update_effector_direct_descendents();
 	void generate_bones_map();
-	Ref<IKBoneChain> get_child_segment_containing(const Ref<IKBone3D> &p_bone);
 	void create_headings();
 	PackedVector3Array* update_target_headings(Ref<IKBone3D> p_for_bone, Vector<real_t> *&p_weights);
 	PackedVector3Array* update_tip_headings(Ref<IKBone3D> p_for_bone);
-	real_t get_manual_sqrmsd() const;
-	real_t set_optimal_rotation(Ref<IKBone3D> p_for_bone, const PackedVector3Array &p_htarget,
-		const PackedVector3Array &p_htip, const Vector<real_t> &p_weights);
-	void segment_solver(int32_t p_stabilization_passes);
-	void qcp_solver(int32_t p_stabilization_passes);
-	void update_optimal_rotation(Ref<IKBone3D> p_for_bone, int32_t p_stabilization_passes);
+	real_t get_manual_sqrmsd(const PackedVector3Array &p_htip, const PackedVector3Array &p_htarget,
+		const Vector<real_t> &p_weights) const;
+	Quat set_optimal_rotation(Ref<IKBone3D> p_for_bone, const PackedVector3Array &p_htarget,
+		const PackedVector3Array &p_htip, const Vector<real_t> &p_weights, real_t p_relaxation = 1.0);
+	static Quat scale_rotation(const Quat &p_rot, real_t p_factor);
+	int32_t get_scheduled_passes() const;
+	void segment_solver(int32_t p_stabilization_passes, real_t p_relaxation, int32_t p_coarse_bones);
+	void qcp_solver(int32_t p_stabilization_passes, real_t p_relaxation);
+	void coarse_qcp_solver(int32_t p_coarse_bones, real_t p_relaxation);
+	void update_optimal_rotation(Ref<IKBone3D> p_for_bone, int32_t p_stabilization_passes, real_t p_relaxation);
+	void update_reach();
+	void update_solve_bones();
+	bool straighten();
 
 protected:
 	static void _bind_methods();
@@ -79,13 +117,29 @@ public:
 	Ref<IKBone3D> get_tip() const;
 	bool is_root_pinned() const;
 	bool is_tip_effector() const;
+	bool is_held() const;
 	Vector<Ref<IKBoneChain>> get_child_chains() const;
 	Vector<Ref<IKBoneChain>> get_effector_direct_descendents() const;
 	int32_t get_effector_direct_descendents_size() const;
 	void get_bone_list(Vector<Ref<IKBone3D>> &p_list) const;
+	Ref<IKBoneChain> get_child_segment_containing(const Ref<IKBone3D> &p_bone) const;
+	real_t get_reach() const;
+	bool is_reachable() const;
 	void generate_default_segments_from_root();
-	void update_effector_list();
-	void grouped_segment_solver(int32_t p_stabilization_passes);
+	void update_effector_list(real_t p_weight_threshold = 0.0);
+	void get_heading_counts(Dictionary &r_report) const;
+	void update_heading_weights();
+	void update_solver_backend(IKSolverBackend::Type p_default);
+	void update_dirty(real_t p_distance, real_t p_angle, bool p_force, bool p_parent_input_dirty = false);
+	void propagate_dirty(bool p_parent_dirty = false);
+	void seed_rotations(real_t p_warm_start_blend);
+	void mark_solved();
+	void solve_unreachable(bool p_parent_dirty = false);
+	void grouped_segment_solver(int32_t p_stabilization_passes, real_t p_relaxation = 1.0, int32_t p_coarse_bones = 1, bool p_parallel = false);
+	static void grouped_segment_solver_lanes(IKBoneChain *const *p_chains, uint32_t p_mask, const real_t *p_relaxation);
+	bool is_lane_compatible() const;
+	uint32_t hash_layout(uint32_t p_hash) const;
+	bool is_layout_equal(const IKBoneChain *p_other) const;
 	void debug_print_chains(Vector<bool> p_levels = Vector<bool>());
 
 	IKBoneChain() {}
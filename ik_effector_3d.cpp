@@ -30,6 +30,8 @@
 
 #include "ik_effector_3d.h"
 
+#include "ik_solver_backend.h"
+
 void IKEffector3D::set_target_transform(const Transform &p_target_transform) {
 	target_transform = p_target_transform;
 }
@@ -75,21 +77,193 @@ bool IKEffector3D::is_following_translation_only() const {
 	return !(follow_x || follow_y || follow_z);
 }
 
-void IKEffector3D::update_goal_transform(Skeleton3D *p_skeleton) {
-	goal_transform = Transform();
+void IKEffector3D::set_weight(real_t p_weight) {
+	weight = MAX(p_weight, 0.0);
+}
+
+real_t IKEffector3D::get_weight() const {
+	return weight;
+}
+
+void IKEffector3D::set_enabled(bool p_enabled) {
+	enabled = p_enabled;
+}
+
+bool IKEffector3D::is_enabled() const {
+	return enabled;
+}
+
+bool IKEffector3D::update_active(real_t p_lod_factor) {
+	// Disabled effectors and the ones below the level of detail threshold both leave zeroed slots behind.
+	bool was_active = active;
+	active = gathered_enabled && p_lod_factor >= gathered_lod_threshold;
+	return active != was_active;
+}
+
+void IKEffector3D::update_heading_weights(const Vector<real_t> &p_weights) {
+	// Same layout as create_headings(), written in place.
+	int32_t nw = p_weights.size() - 2;
+	for (int32_t i_w = 0; i_w < nw; i_w++) {
+		heading_weights.write[i_w] = p_weights[i_w];
+	}
+	real_t w = active ? gathered_weight : 0.0;
+	heading_weights.write[nw] = w;
+	heading_weights.write[nw + 1] = w;
+}
+
+void IKEffector3D::set_solver_backend(int32_t p_backend) {
+	// Negative values inherit the backend of the modification.
+	solver_backend = CLAMP(p_backend, -1, int32_t(IKSolverBackend::TYPE_MAX) - 1);
+}
+
+int32_t IKEffector3D::get_solver_backend() const {
+	return solver_backend;
+}
+
+void IKEffector3D::set_depth_falloff(real_t p_falloff) {
+	depth_falloff = CLAMP(p_falloff, 0.0, 1.0);
+}
+
+real_t IKEffector3D::get_depth_falloff() const {
+	return depth_falloff;
+}
+
+void IKEffector3D::set_budget(real_t p_budget) {
+	budget = MAX(p_budget, 0.0);
+}
+
+real_t IKEffector3D::get_budget() const {
+	return budget;
+}
+
+void IKEffector3D::set_lod_threshold(real_t p_threshold) {
+	lod_threshold = CLAMP(p_threshold, 0.0, 1.0);
+}
+
+real_t IKEffector3D::get_lod_threshold() const {
+	return lod_threshold;
+}
+
+void IKEffector3D::set_update_divider(int32_t p_divider) {
+	update_divider = MAX(p_divider, 1);
+}
+
+int32_t IKEffector3D::get_update_divider() const {
+	return update_divider;
+}
+
+void IKEffector3D::update_held(bool p_allowed, uint64_t p_tick) {
+	// Only one in every update_divider ticks lets the effector through, the rest keep its last solution.
+	held = p_allowed && gathered_update_divider > 1 && p_tick % gathered_update_divider != 0;
+	deferred = false;
+}
+
+bool IKEffector3D::is_held() const {
+	return held;
+}
+
+bool IKEffector3D::is_deferred() const {
+	return deferred;
+}
+
+bool IKEffector3D::is_unreachable() const {
+	return unreachable;
+}
+
+real_t IKEffector3D::get_error() const {
+	Transform tip_xform = for_bone->get_global_transform();
+	real_t error = tip_xform.origin.distance_to(goal_transform.origin);
+	// In lengths of the chain, so the distance ranks against the angle the same way on any rig scale.
+	if (reach > CMP_EPSILON) {
+		error /= reach;
+	}
+	if (!is_following_translation_only()) {
+		// Same axis as the simplified orientation headings.
+		Vector3 tip_y = tip_xform.basis.get_axis(Vector3::AXIS_Y);
+		Vector3 goal_y = goal_transform.basis.get_axis(Vector3::AXIS_Y);
+		error = MAX(error, tip_y.angle_to(goal_y));
+	}
+	return error;
+}
+
+real_t IKEffector3D::update_error() {
+	error = get_error();
+	return error;
+}
+
+bool IKEffector3D::is_pending(real_t p_tolerance, real_t p_lod_factor) const {
+	// Secondary effectors, like fingers and toes, drop out once the level of detail falls below their threshold.
+	// Straightened out-of-reach chains are already as close as they can get, and a zero budget skips the effector.
+	return dirty && active && !unreachable && gathered_budget > 0.0 && p_lod_factor >= gathered_lod_threshold && error > p_tolerance;
+}
+
+void IKEffector3D::schedule_passes(real_t p_mean_error, real_t p_tolerance, real_t p_lod_factor) {
+	if (!is_pending(p_tolerance, p_lod_factor)) {
+		scheduled_passes = 0;
+		return;
+	}
+	// An effector at the mean error with the default budget gets one pass per iteration.
+	int32_t passes = int32_t(Math::round(gathered_budget * error / p_mean_error));
+	scheduled_passes = CLAMP(passes, 1, MAX_SCHEDULED_PASSES);
+}
+
+int32_t IKEffector3D::get_scheduled_passes() const {
+	return scheduled_passes;
+}
+
+real_t IKEffector3D::update_input_motion() {
+	// How far the goal and the animated tip jumped since the previous solve.
+	Vector3 initial_origin = for_bone->get_global_transform().origin;
+	real_t motion = MAXFLOAT;
+	if (has_prev_input) {
+		motion = MAX(goal_transform.origin.distance_to(prev_goal_transform.origin),
+				initial_origin.distance_to(prev_initial_origin));
+	}
+	prev_goal_transform = goal_transform;
+	prev_initial_origin = initial_origin;
+	has_prev_input = true;
+	return motion;
+}
+
+bool IKEffector3D::is_goal_changed(real_t p_distance, real_t p_angle) const {
+	return !IKTransform::is_equal_within(goal_transform, solved_goal_transform, p_distance, p_angle);
+}
+
+bool IKEffector3D::is_dirty() const {
+	return dirty;
+}
+
+bool IKEffector3D::gather_target(Skeleton3D *p_skeleton) {
+	bool weight_changed = gathered_weight != weight || gathered_enabled != enabled;
+	gathered_target_transform = target_transform;
+	gathered_weight = weight;
+	gathered_enabled = enabled;
+	gathered_budget = budget;
+	gathered_lod_threshold = lod_threshold;
+	gathered_update_divider = update_divider;
+
+	has_node_goal = false;
 	Node *node = p_skeleton->get_node_or_null(target_nodepath);
 	if (node && node->is_class("Node3D")) {
 		Node3D *target_node = Object::cast_to<Node3D>(node);
 		Transform node_xform = target_node->get_global_transform();
 		if (use_target_node_rotation) {
-			goal_transform = p_skeleton->get_global_transform().affine_inverse() * node_xform;
+			node_goal_transform = p_skeleton->get_global_transform().affine_inverse() * node_xform;
 		} else {
-			goal_transform = Transform(Basis(), p_skeleton->to_local(node_xform.origin));
+			node_goal_transform = Transform(Basis(), p_skeleton->to_local(node_xform.origin));
 		}
 		prev_node_xform = node_xform;
-		goal_transform = target_transform * goal_transform;
+		has_node_goal = true;
+	}
+	return weight_changed;
+}
+
+void IKEffector3D::update_goal_transform() {
+	// Target nodes were resolved by gather_target, so this stays within the shadow skeleton.
+	if (has_node_goal) {
+		goal_transform = gathered_target_transform * node_goal_transform;
 	} else {
-		goal_transform = for_bone->get_global_transform() * target_transform;
+		goal_transform = for_bone->get_global_transform() * gathered_target_transform;
 	}
 }
 
@@ -309,6 +483,41 @@ void IKEffector3D::_bind_methods() {
 			&IKEffector3D::set_target_node);
 	ClassDB::bind_method(D_METHOD("get_target_node"),
 			&IKEffector3D::get_target_node);
+
+	ClassDB::bind_method(D_METHOD("set_weight", "weight"),
+			&IKEffector3D::set_weight);
+	ClassDB::bind_method(D_METHOD("get_weight"),
+			&IKEffector3D::get_weight);
+
+	ClassDB::bind_method(D_METHOD("set_enabled", "enabled"),
+			&IKEffector3D::set_enabled);
+	ClassDB::bind_method(D_METHOD("is_enabled"),
+			&IKEffector3D::is_enabled);
+
+	ClassDB::bind_method(D_METHOD("set_solver_backend", "backend"),
+			&IKEffector3D::set_solver_backend);
+	ClassDB::bind_method(D_METHOD("get_solver_backend"),
+			&IKEffector3D::get_solver_backend);
+
+	ClassDB::bind_method(D_METHOD("set_depth_falloff", "falloff"),
+			&IKEffector3D::set_depth_falloff);
+	ClassDB::bind_method(D_METHOD("get_depth_falloff"),
+			&IKEffector3D::get_depth_falloff);
+
+	ClassDB::bind_method(D_METHOD("set_budget", "budget"),
+			&IKEffector3D::set_budget);
+	ClassDB::bind_method(D_METHOD("get_budget"),
+			&IKEffector3D::get_budget);
+
+	ClassDB::bind_method(D_METHOD("set_lod_threshold", "threshold"),
+			&IKEffector3D::set_lod_threshold);
+	ClassDB::bind_method(D_METHOD("get_lod_threshold"),
+			&IKEffector3D::get_lod_threshold);
+
+	ClassDB::bind_method(D_METHOD("set_update_divider", "divider"),
+			&IKEffector3D::set_update_divider);
+	ClassDB::bind_method(D_METHOD("get_update_divider"),
+			&IKEffector3D::get_update_divider);
 }
 
 IKEffector3D::IKEffector3D(const Ref<IKBone3D> &p_for_bone) {
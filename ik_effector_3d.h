@@ -35,6 +35,7 @@
 #include "scene/3d/skeleton_3d.h"
 
 #define MIN_SCALE 0.1
+#define MAX_SCHEDULED_PASSES 4
 
 class IKBone3D;
 
@@ -53,15 +54,42 @@ private:
 	int32_t num_headings;
 	Vector3 priority = Vector3(0.5, 5.0, 0.0);
 	real_t weight = 1.0;
+	bool enabled = true;
+	int32_t solver_backend = -1;
+	bool active = true;
+	real_t budget = 1.0;
+	real_t lod_threshold = 0.0;
+	int32_t update_divider = 1;
+	bool held = false;
+	bool deferred = false;
+	bool unreachable = false;
+	real_t reach = 0.0;
+	real_t error = 0.0;
+	int32_t scheduled_passes = 1;
+	bool dirty = true;
+	Transform solved_goal_transform;
 	bool follow_x, follow_y, follow_z;
 	PackedVector3Array target_headings;
 	PackedVector3Array tip_headings;
 	Vector<real_t> heading_weights;
 
+	// Copied by gather_target(), so a solve on another thread never reads what the setters write.
+	Transform gathered_target_transform;
+	real_t gathered_weight = 1.0;
+	bool gathered_enabled = true;
+	real_t gathered_budget = 1.0;
+	real_t gathered_lod_threshold = 0.0;
+	int32_t gathered_update_divider = 1;
+
+	Transform node_goal_transform;
+	bool has_node_goal = false;
 	Transform prev_node_xform;
+	Transform prev_goal_transform;
+	Vector3 prev_initial_origin;
+	bool has_prev_input = false;
 
 	void update_priorities();
-	void update_goal_transform(Skeleton3D *p_skeleton);
+	void update_goal_transform();
 
 protected:
 	static void _bind_methods();
@@ -76,9 +104,38 @@ public:
 	bool get_use_target_node_rotation() const;
 	Transform get_goal_transform() const;
 	bool is_node_xform_changed(Skeleton3D *p_skeleton) const;
+	bool gather_target(Skeleton3D *p_skeleton);
 	Ref<IKBone3D> get_shadow_bone() const;
 	void create_weights(Vector<real_t> &p_weights, real_t p_falloff) const;
 	bool is_following_translation_only() const;
+	void set_weight(real_t p_weight);
+	real_t get_weight() const;
+	void set_enabled(bool p_enabled);
+	bool is_enabled() const;
+	bool update_active(real_t p_lod_factor);
+	void update_heading_weights(const Vector<real_t> &p_weights);
+	void set_solver_backend(int32_t p_backend);
+	int32_t get_solver_backend() const;
+	void set_depth_falloff(real_t p_falloff);
+	real_t get_depth_falloff() const;
+	void set_budget(real_t p_budget);
+	real_t get_budget() const;
+	void set_lod_threshold(real_t p_threshold);
+	real_t get_lod_threshold() const;
+	void set_update_divider(int32_t p_divider);
+	int32_t get_update_divider() const;
+	void update_held(bool p_allowed, uint64_t p_tick);
+	bool is_held() const;
+	bool is_deferred() const;
+	bool is_unreachable() const;
+	real_t get_error() const;
+	real_t update_error();
+	real_t update_input_motion();
+	bool is_goal_changed(real_t p_distance, real_t p_angle) const;
+	bool is_dirty() const;
+	bool is_pending(real_t p_tolerance, real_t p_lod_factor) const;
+	void schedule_passes(real_t p_mean_error, real_t p_tolerance, real_t p_lod_factor);
+	int32_t get_scheduled_passes() const;
 	void update_target_headings(Ref<IKBone3D> p_for_bone, PackedVector3Array *p_headings, int32_t &p_index, Vector<real_t> *p_weights) const;
 	void update_tip_headings(Ref<IKBone3D> p_for_bone, PackedVector3Array *p_headings, int32_t &p_index) const;
 
@@ -0,0 +1,164 @@
+/*************************************************************************/
+/*  ik_solver_backend.cpp                                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "ik_solver_backend.h"
+
+#include "ik_bone_chain.h"
+
+void IKSolverBackend::solve_qcp(IKBoneChain &p_chain, int32_t p_stabilization_passes, real_t p_relaxation) {
+	p_chain.qcp_solver(p_stabilization_passes, p_relaxation);
+}
+
+bool IKSolverBackend::is_single_target(const IKBoneChain &p_chain) {
+	return p_chain.is_tip_effector() && p_chain.effector_list.size() == 1;
+}
+
+const Vector<Ref<IKBone3D>> &IKSolverBackend::get_solve_bones(const IKBoneChain &p_chain) {
+	return p_chain.solve_bones;
+}
+
+int32_t IKSolverBackend::get_bone_count(const IKBoneChain &p_chain) {
+	return p_chain.bone_count;
+}
+
+PackedVector3Array &IKSolverBackend::get_solver_points(IKBoneChain &p_chain) {
+	return p_chain.solver_points;
+}
+
+Vector3 IKSolverBackend::get_goal_origin(const IKBoneChain &p_chain) {
+	return p_chain.tip->get_effector()->get_goal_transform().origin;
+}
+
+void IKSolverBackend::orient_tip(IKBoneChain &p_chain) {
+	Ref<IKBone3D> tip = p_chain.tip;
+	if (!tip->is_rigid() && !tip->get_effector()->is_following_translation_only()) {
+		p_chain.update_optimal_rotation(tip, 0, 1.0);
+	}
+}
+
+void IKSolverBackend::rotate_towards(const Ref<IKBone3D> &p_bone, const Vector3 &p_from, const Vector3 &p_to, real_t p_relaxation) {
+	Transform global = p_bone->get_global_transform();
+	Vector3 from = p_from - global.origin;
+	Vector3 to = p_to - global.origin;
+	if (from.length_squared() < CMP_EPSILON2 || to.length_squared() < CMP_EPSILON2) {
+		return;
+	}
+	Quat rot = Quat(from.normalized(), to.normalized());
+	if (p_relaxation != 1.0) {
+		rot = IKBoneChain::scale_rotation(rot, p_relaxation);
+	}
+	Quat basis_rot = global.basis.get_rotation_quat();
+	p_bone->set_rot_delta(basis_rot.inverse() * rot * basis_rot);
+}
+
+class IKSolverBackendQCP : public IKSolverBackend {
+public:
+	virtual void solve(IKBoneChain &p_chain, int32_t p_stabilization_passes, real_t p_relaxation) const override {
+		solve_qcp(p_chain, p_stabilization_passes, p_relaxation);
+	}
+};
+
+// CCD and FABRIK only know how to reach a single position, so chains that carry several
+// effectors stay on QCP. So do chains with rigid bones, which FABRIK can't rebuild.
+class IKSolverBackendCCD : public IKSolverBackend {
+public:
+	virtual void solve(IKBoneChain &p_chain, int32_t p_stabilization_passes, real_t p_relaxation) const override {
+		if (!is_single_target(p_chain)) {
+			solve_qcp(p_chain, p_stabilization_passes, p_relaxation);
+			return;
+		}
+		Ref<IKBone3D> tip = p_chain.get_tip();
+		Vector3 goal = get_goal_origin(p_chain);
+		const Vector<Ref<IKBone3D>> &bones = get_solve_bones(p_chain);
+		for (int32_t bone_i = 0; bone_i < bones.size(); bone_i++) {
+			if (bones[bone_i] == tip) {
+				orient_tip(p_chain);
+			} else {
+				rotate_towards(bones[bone_i], tip->get_global_transform().origin, goal, p_relaxation);
+			}
+		}
+	}
+};
+
+class IKSolverBackendFABRIK : public IKSolverBackend {
+public:
+	virtual void solve(IKBoneChain &p_chain, int32_t p_stabilization_passes, real_t p_relaxation) const override {
+		const Vector<Ref<IKBone3D>> &bones = get_solve_bones(p_chain);
+		if (!is_single_target(p_chain) || bones.size() != get_bone_count(p_chain)) {
+			solve_qcp(p_chain, p_stabilization_passes, p_relaxation);
+			return;
+		}
+
+		// The bones run from the tip to the root, the points from the root to the tip.
+		int32_t n = bones.size();
+		PackedVector3Array &points = get_solver_points(p_chain);
+		points.resize(n);
+		Vector3 *pw = points.ptrw();
+		for (int32_t point_i = 0; point_i < n; point_i++) {
+			pw[point_i] = bones[n - 1 - point_i]->get_global_transform().origin;
+		}
+		Vector3 root_origin = pw[0];
+
+		// One forward and one backward reaching pass, with segment lengths taken from the current pose.
+		Vector3 prev = pw[n - 1];
+		pw[n - 1] = get_goal_origin(p_chain);
+		for (int32_t point_i = n - 2; point_i >= 0; point_i--) {
+			real_t length = pw[point_i].distance_to(prev);
+			prev = pw[point_i];
+			pw[point_i] = pw[point_i + 1] + (pw[point_i] - pw[point_i + 1]).normalized() * length;
+		}
+		pw[0] = root_origin;
+		for (int32_t point_i = 1; point_i < n; point_i++) {
+			real_t length = bones[n - point_i]->get_global_transform().origin.distance_to(bones[n - 1 - point_i]->get_global_transform().origin);
+			pw[point_i] = pw[point_i - 1] + (pw[point_i] - pw[point_i - 1]).normalized() * length;
+		}
+
+		// Back to rotations from the root down, so every bone aims from where its parent left it.
+		// Over-relaxation scales each aim, as it does the CCD steps.
+		for (int32_t point_i = 0; point_i < n - 1; point_i++) {
+			rotate_towards(bones[n - 1 - point_i], bones[n - 2 - point_i]->get_global_transform().origin, pw[point_i + 1], p_relaxation);
+		}
+		orient_tip(p_chain);
+	}
+};
+
+const IKSolverBackend *IKSolverBackend::get_backend(Type p_type) {
+	static const IKSolverBackendQCP qcp;
+	static const IKSolverBackendCCD ccd;
+	static const IKSolverBackendFABRIK fabrik;
+	switch (p_type) {
+		case TYPE_CCD:
+			return &ccd;
+		case TYPE_FABRIK:
+			return &fabrik;
+		default:
+			return &qcp;
+	}
+}
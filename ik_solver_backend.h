@@ -0,0 +1,68 @@
+/*************************************************************************/
+/*  ik_solver_backend.h                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef IK_SOLVER_BACKEND_H
+#define IK_SOLVER_BACKEND_H
+
+#include "core/math/vector3.h"
+#include "core/object/reference.h"
+#include "core/templates/vector.h"
+
+class IKBone3D;
+class IKBoneChain;
+
+class IKSolverBackend {
+protected:
+	// Chain internals are only reached through these, so the chain needs a single friend.
+	static void solve_qcp(IKBoneChain &p_chain, int32_t p_stabilization_passes, real_t p_relaxation);
+	static bool is_single_target(const IKBoneChain &p_chain);
+	static const Vector<Ref<IKBone3D>> &get_solve_bones(const IKBoneChain &p_chain);
+	static int32_t get_bone_count(const IKBoneChain &p_chain);
+	static PackedVector3Array &get_solver_points(IKBoneChain &p_chain);
+	static Vector3 get_goal_origin(const IKBoneChain &p_chain);
+	static void orient_tip(IKBoneChain &p_chain);
+	static void rotate_towards(const Ref<IKBone3D> &p_bone, const Vector3 &p_from, const Vector3 &p_to, real_t p_relaxation);
+
+public:
+	enum Type {
+		TYPE_QCP,
+		TYPE_CCD,
+		TYPE_FABRIK,
+		TYPE_MAX
+	};
+
+	static const IKSolverBackend *get_backend(Type p_type);
+
+	// Runs one solver pass over the bones of a single chain.
+	virtual void solve(IKBoneChain &p_chain, int32_t p_stabilization_passes, real_t p_relaxation) const = 0;
+	virtual ~IKSolverBackend() {}
+};
+
+#endif // IK_SOLVER_BACKEND_H
@@ -0,0 +1,288 @@
+/*************************************************************************/
+/*  ik_task_scheduler.cpp                                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "ik_task_scheduler.h"
+
+#include "core/os/os.h"
+
+IKTaskScheduler *IKTaskScheduler::singleton = nullptr;
+
+// Per thread scheduling state. The path is the length of the longest dependency chain that
+// ends in the running task, measured in task time only.
+static thread_local int32_t current_worker = -1;
+static thread_local int32_t execute_depth = 0;
+static thread_local const void *current_job = nullptr;
+static thread_local uint64_t path_base_usec = 0;
+static thread_local uint64_t path_resume_usec = 0;
+static thread_local uint64_t idle_usec = 0;
+
+IKTaskScheduler *IKTaskScheduler::get_singleton() {
+	return singleton;
+}
+
+void IKTaskScheduler::_worker_thread(void *p_worker) {
+	Worker *worker = (Worker *)p_worker;
+	IKTaskScheduler *scheduler = worker->scheduler;
+	current_worker = worker->index;
+	while (true) {
+		scheduler->semaphore.wait();
+		if (scheduler->exit.is_set()) {
+			break;
+		}
+		Task task;
+		while (scheduler->pop_task(worker->index, nullptr, task)) {
+			scheduler->execute(worker->index, task);
+		}
+	}
+}
+
+bool IKTaskScheduler::is_part_of(const Job *p_job, const Job *p_of) {
+	for (; p_job; p_job = p_job->parent) {
+		if (p_job == p_of) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool IKTaskScheduler::pop_task(int32_t p_worker, const Job *p_of, Task &r_task) {
+	// A caller waiting on a job only takes tasks of that job and of the jobs its tasks spawned,
+	// anything else, like an asynchronous rig solve, could keep it busy long after its job is done.
+	{
+		Worker &own = workers[p_worker];
+		MutexLock lock(own.mutex);
+		for (int32_t task_i = int32_t(own.tasks.size()) - 1; task_i >= 0; task_i--) {
+			if (!p_of || is_part_of(own.tasks[task_i].job, p_of)) {
+				// The newest task is the one whose inputs are most likely still in cache.
+				r_task = own.tasks[task_i];
+				own.tasks.remove(task_i);
+				return true;
+			}
+		}
+	}
+	for (int32_t offset = 1; offset < worker_count; offset++) {
+		Worker &victim = workers[(p_worker + offset) % worker_count];
+		MutexLock lock(victim.mutex);
+		for (uint32_t task_i = 0; task_i < victim.tasks.size(); task_i++) {
+			if (!p_of || is_part_of(victim.tasks[task_i].job, p_of)) {
+				// The oldest task is the biggest piece of work left, usually a whole rig or subtree.
+				r_task = victim.tasks[task_i];
+				victim.tasks.remove(task_i);
+				workers[p_worker].steal_count.increment();
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void IKTaskScheduler::execute(int32_t p_worker, const Task &p_task) {
+	uint64_t saved_base = path_base_usec;
+	uint64_t saved_resume = path_resume_usec;
+	uint64_t saved_idle = idle_usec;
+	const void *saved_job = current_job;
+	execute_depth++;
+
+	uint64_t start_usec = OS::get_singleton()->get_ticks_usec();
+	path_base_usec = p_task.job->spawn_path_usec;
+	path_resume_usec = start_usec;
+	current_job = p_task.job;
+	p_task.job->function(p_task.job->userdata, p_task.index);
+	uint64_t end_usec = OS::get_singleton()->get_ticks_usec();
+	p_task.job->end_path_usec.exchange_if_greater(path_base_usec + (end_usec - path_resume_usec));
+
+	execute_depth--;
+	current_job = saved_job;
+	path_base_usec = saved_base;
+	path_resume_usec = saved_resume;
+	if (execute_depth == 0) {
+		// Nested tasks are part of this one, only the sleeps waiting for stolen tasks are idle.
+		workers[p_worker].busy_usec.add(end_usec - start_usec - (idle_usec - saved_idle));
+	}
+	// Last, the job may go out of scope as soon as its count drops to zero and its owner wakes.
+	Semaphore *done = p_task.job->done;
+	if (p_task.job->remaining.decrement() == 0 && done) {
+		done->post();
+	}
+}
+
+void IKTaskScheduler::run(TaskFunction p_function, void *p_userdata, uint32_t p_count) {
+	if (p_count == 0) {
+		return;
+	}
+	bool external = current_worker == -1;
+	if (external && (worker_count < 2 || external_mutex.try_lock() != OK)) {
+		// Another thread already drives a graph, or there is nobody to share with.
+		for (uint32_t task_i = 0; task_i < p_count; task_i++) {
+			p_function(p_userdata, task_i);
+		}
+		return;
+	}
+	uint64_t now_usec = OS::get_singleton()->get_ticks_usec();
+	if (external) {
+		current_worker = 0;
+		path_base_usec = 0;
+		path_resume_usec = now_usec;
+	}
+
+	Semaphore done;
+	Job job;
+	job.function = p_function;
+	job.userdata = p_userdata;
+	job.parent = (const Job *)current_job;
+	job.done = &done;
+	job.spawn_path_usec = path_base_usec + (now_usec - path_resume_usec);
+	job.end_path_usec.set(job.spawn_path_usec);
+	job.remaining.set(p_count);
+	{
+		Worker &own = workers[current_worker];
+		MutexLock lock(own.mutex);
+		// Pushed in reverse, so the owner works through them in order.
+		for (uint32_t task_i = p_count; task_i > 0; task_i--) {
+			Task task;
+			task.job = &job;
+			task.index = task_i - 1;
+			own.tasks.push_back(task);
+		}
+	}
+	task_count.add(p_count);
+	for (uint32_t wake_i = 0; wake_i < MIN(p_count, uint32_t(worker_count - 1)); wake_i++) {
+		semaphore.post();
+	}
+
+	// Waiting means working on these tasks, wherever they were queued, and on those they spawned.
+	// Once none is left to take the rest runs on other workers, so the caller sleeps until the
+	// last task posts, which may already have happened here.
+	Task task;
+	while (pop_task(current_worker, &job, task)) {
+		execute(current_worker, task);
+	}
+	uint64_t idle_start_usec = OS::get_singleton()->get_ticks_usec();
+	done.wait();
+	now_usec = OS::get_singleton()->get_ticks_usec();
+	idle_usec += now_usec - idle_start_usec;
+
+	// The caller continues after the slowest of the tasks it spawned.
+	path_base_usec = job.end_path_usec.get();
+	path_resume_usec = now_usec;
+	if (external) {
+		critical_path_usec = MAX(critical_path_usec, path_base_usec);
+		current_worker = -1;
+		external_mutex.unlock();
+	}
+}
+
+void IKTaskScheduler::submit(AsyncTask &r_task, TaskFunction p_function, void *p_userdata) {
+	ERR_FAIL_COND_MSG(r_task.pending, "EWBIK async task is still running.");
+	r_task.pending = true;
+	if (worker_count < 2) {
+		// Nobody to hand it to, so it is done by the time the owner waits.
+		p_function(p_userdata, 0);
+		r_task.done.post();
+		return;
+	}
+	Job &job = r_task.job;
+	job.function = p_function;
+	job.userdata = p_userdata;
+	job.spawn_path_usec = 0;
+	job.end_path_usec.set(0);
+	job.remaining.set(1);
+	job.done = &r_task.done;
+	Task task;
+	task.job = &job;
+	{
+		// Spread over the workers, slot 0 is left to the threads that start graphs.
+		Worker &worker = workers[1 + submit_count.increment() % (worker_count - 1)];
+		MutexLock lock(worker.mutex);
+		worker.tasks.push_back(task);
+	}
+	task_count.increment();
+	semaphore.post();
+}
+
+void IKTaskScheduler::wait(AsyncTask &r_task) {
+	if (!r_task.pending) {
+		return;
+	}
+	r_task.done.wait();
+	r_task.pending = false;
+}
+
+void IKTaskScheduler::begin_frame() {
+	frame_start_usec = OS::get_singleton()->get_ticks_usec();
+	critical_path_usec = 0;
+	task_count.set(0);
+	for (int32_t worker_i = 0; worker_i < worker_count; worker_i++) {
+		workers[worker_i].busy_usec.set(0);
+		workers[worker_i].steal_count.set(0);
+	}
+}
+
+IKTaskScheduler::FrameStats IKTaskScheduler::end_frame() {
+	FrameStats stats;
+	uint64_t wall_usec = OS::get_singleton()->get_ticks_usec() - frame_start_usec;
+	uint64_t busy_usec = 0;
+	for (int32_t worker_i = 0; worker_i < worker_count; worker_i++) {
+		busy_usec += workers[worker_i].busy_usec.get();
+		stats.steal_count += workers[worker_i].steal_count.get();
+	}
+	stats.thread_count = worker_count;
+	stats.task_count = task_count.get();
+	stats.wall_millisecond = wall_usec / 1000.0;
+	stats.busy_millisecond = busy_usec / 1000.0;
+	stats.utilization = wall_usec ? real_t(busy_usec) / (real_t(wall_usec) * worker_count) : 0.0;
+	stats.critical_path_millisecond = critical_path_usec / 1000.0;
+	return stats;
+}
+
+IKTaskScheduler::IKTaskScheduler(int32_t p_thread_count) {
+	singleton = this;
+	worker_count = MAX(p_thread_count, 1);
+	workers = memnew_arr(Worker, worker_count);
+	for (int32_t worker_i = 0; worker_i < worker_count; worker_i++) {
+		workers[worker_i].scheduler = this;
+		workers[worker_i].index = worker_i;
+		if (worker_i > 0) {
+			workers[worker_i].thread.start(_worker_thread, &workers[worker_i]);
+		}
+	}
+}
+
+IKTaskScheduler::~IKTaskScheduler() {
+	exit.set();
+	for (int32_t worker_i = 1; worker_i < worker_count; worker_i++) {
+		semaphore.post();
+	}
+	for (int32_t worker_i = 1; worker_i < worker_count; worker_i++) {
+		workers[worker_i].thread.wait_to_finish();
+	}
+	memdelete_arr(workers);
+	singleton = nullptr;
+}
@@ -0,0 +1,128 @@
+/*************************************************************************/
+/*  ik_task_scheduler.h                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef IK_TASK_SCHEDULER_H
+#define IK_TASK_SCHEDULER_H
+
+#include "core/os/mutex.h"
+#include "core/os/semaphore.h"
+#include "core/os/thread.h"
+#include "core/templates/local_vector.h"
+#include "core/templates/safe_refcount.h"
+
+// Work-stealing scheduler for the solve task graph. A task that spawns tasks waits for them
+// by running the queued tasks of its own graph, and sleeps once the rest is taken. Every worker
+// pops its own newest task and steals the oldest one of another worker when it runs dry.
+class IKTaskScheduler {
+public:
+	typedef void (*TaskFunction)(void *p_userdata, uint32_t p_index);
+
+	struct FrameStats {
+		int32_t thread_count = 0;
+		int32_t task_count = 0;
+		int32_t steal_count = 0;
+		real_t wall_millisecond = 0.0;
+		real_t busy_millisecond = 0.0;
+		real_t utilization = 0.0;
+		real_t critical_path_millisecond = 0.0;
+	};
+
+private:
+	struct Job {
+		TaskFunction function = nullptr;
+		void *userdata = nullptr;
+		// The job of the task that spawned this one, it outlives every job below it.
+		const Job *parent = nullptr;
+		uint64_t spawn_path_usec = 0;
+		SafeNumeric<uint32_t> remaining;
+		SafeNumeric<uint64_t> end_path_usec;
+		// Posted by whoever finishes the last task, the owner sleeps on it once it can't help.
+		Semaphore *done = nullptr;
+	};
+
+	struct Task {
+		Job *job = nullptr;
+		uint32_t index = 0;
+	};
+
+	struct Worker {
+		IKTaskScheduler *scheduler = nullptr;
+		int32_t index = 0;
+		Mutex mutex;
+		LocalVector<Task> tasks;
+		SafeNumeric<uint64_t> busy_usec;
+		SafeNumeric<uint32_t> steal_count;
+		Thread thread;
+	};
+
+	static IKTaskScheduler *singleton;
+
+	Worker *workers = nullptr;
+	int32_t worker_count = 0;
+	Semaphore semaphore;
+	SafeFlag exit;
+	// Slot 0 belongs to the thread that starts a graph from outside the workers.
+	Mutex external_mutex;
+	SafeNumeric<uint32_t> task_count;
+	SafeNumeric<uint32_t> submit_count;
+	uint64_t frame_start_usec = 0;
+	uint64_t critical_path_usec = 0;
+
+	static void _worker_thread(void *p_worker);
+	static bool is_part_of(const Job *p_job, const Job *p_of);
+	bool pop_task(int32_t p_worker, const Job *p_of, Task &r_task);
+	void execute(int32_t p_worker, const Task &p_task);
+
+public:
+	// A single task that runs on the workers while its owner goes on, joined with wait().
+	class AsyncTask {
+		friend class IKTaskScheduler;
+		Job job;
+		Semaphore done;
+		bool pending = false;
+	};
+
+	static IKTaskScheduler *get_singleton();
+
+	// Runs p_count instances of p_function and returns once all of them are done.
+	// Called from a task, the new tasks depend on the work the caller did so far.
+	void run(TaskFunction p_function, void *p_userdata, uint32_t p_count);
+	// Queues p_function on one of the workers and returns right away.
+	void submit(AsyncTask &r_task, TaskFunction p_function, void *p_userdata);
+	static void wait(AsyncTask &r_task);
+
+	void begin_frame();
+	FrameStats end_frame();
+
+	IKTaskScheduler(int32_t p_thread_count);
+	~IKTaskScheduler();
+};
+
+#endif // IK_TASK_SCHEDULER_H
@@ -253,3 +253,11 @@ void IKTransform::orthonormalize() {
 void IKTransform::set_identity() {
 	set_transform(Transform());
 }
+
+bool IKTransform::is_equal_within(const Transform &p_a, const Transform &p_b, real_t p_distance, real_t p_angle) {
+	if (p_a.origin.distance_to(p_b.origin) > p_distance) {
+		return false;
+	}
+	real_t dot = Math::abs(p_a.basis.get_rotation_quat().dot(p_b.basis.get_rotation_quat()));
+	return 2.0 * Math::acos(MIN(dot, 1.0)) <= p_angle;
+}
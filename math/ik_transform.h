@@ -97,6 +97,8 @@ public:
 
 	void orthonormalize();
 	void set_identity();
+
+	static bool is_equal_within(const Transform &p_a, const Transform &p_b, real_t p_distance, real_t p_angle);
 };
 
 #endif // IK_TRANSFORM_H
\ No newline at end of file
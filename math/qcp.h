@@ -35,6 +35,7 @@
 #include "core/variant/variant.h"
 
 class QCP {
+	friend class QCPLanes;
 
 private:
 	real_t evec_prec = FLT_EPSILON;
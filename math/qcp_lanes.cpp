@@ -0,0 +1,193 @@
+/*************************************************************************/
+/*  qcp_lanes.cpp                                                        */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "qcp_lanes.h"
+
+void QCPLanes::calc_optimal_rotations(const Heading *p_coords1, const Heading *p_coords2, const Weight *p_weights,
+		int32_t p_count, uint32_t p_mask, Quat *r_quats) {
+	if (p_count == 1) {
+		// Same single point fallback as QCP::calc_optimal_rotation.
+		for (int32_t lane = 0; lane < LANES; lane++) {
+			if (p_mask & (1 << lane)) {
+				Quat q1 = Quat(Vector3(p_coords1[0].x[lane], p_coords1[0].y[lane], p_coords1[0].z[lane]));
+				Quat q2 = Quat(Vector3(p_coords2[0].x[lane], p_coords2[0].y[lane], p_coords2[0].z[lane]));
+				r_quats[lane] = q1 * q2;
+			}
+		}
+		return;
+	}
+	real_t e0[LANES];
+	inner_product(p_coords1, p_coords2, p_weights, p_count, e0);
+	calc_eigenvalues(e0, p_mask);
+	for (int32_t lane = 0; lane < LANES; lane++) {
+		if (p_mask & (1 << lane)) {
+			r_quats[lane] = calc_rotation(lane, e0[lane]);
+		}
+	}
+}
+
+void QCPLanes::inner_product(const Heading *p_coords1, const Heading *p_coords2, const Weight *p_weights, int32_t p_count, real_t *r_e0) {
+	real_t g1[LANES];
+	real_t g2[LANES];
+	for (int32_t lane = 0; lane < LANES; lane++) {
+		g1[lane] = 0.0;
+		g2[lane] = 0.0;
+		Sxx[lane] = 0.0;
+		Sxy[lane] = 0.0;
+		Sxz[lane] = 0.0;
+		Syx[lane] = 0.0;
+		Syy[lane] = 0.0;
+		Syz[lane] = 0.0;
+		Szx[lane] = 0.0;
+		Szy[lane] = 0.0;
+		Szz[lane] = 0.0;
+	}
+
+	for (int32_t i = 0; i < p_count; i++) {
+		const Heading &c1 = p_coords1[i];
+		const Heading &c2 = p_coords2[i];
+		const real_t *w = p_weights[i].w;
+		for (int32_t lane = 0; lane < LANES; lane++) {
+			real_t x1 = w[lane] * c1.x[lane];
+			real_t y1 = w[lane] * c1.y[lane];
+			real_t z1 = w[lane] * c1.z[lane];
+
+			g1[lane] += x1 * c1.x[lane] + y1 * c1.y[lane] + z1 * c1.z[lane];
+
+			real_t x2 = c2.x[lane];
+			real_t y2 = c2.y[lane];
+			real_t z2 = c2.z[lane];
+
+			g2[lane] += w[lane] * (x2 * x2 + y2 * y2 + z2 * z2);
+
+			Sxx[lane] += (x1 * x2);
+			Sxy[lane] += (x1 * y2);
+			Sxz[lane] += (x1 * z2);
+
+			Syx[lane] += (y1 * x2);
+			Syy[lane] += (y1 * y2);
+			Syz[lane] += (y1 * z2);
+
+			Szx[lane] += (z1 * x2);
+			Szy[lane] += (z1 * y2);
+			Szz[lane] += (z1 * z2);
+		}
+	}
+
+	for (int32_t lane = 0; lane < LANES; lane++) {
+		r_e0[lane] = (g1[lane] + g2[lane]) * 0.5;
+	}
+}
+
+void QCPLanes::calc_eigenvalues(real_t *r_e0, uint32_t p_mask) {
+	real_t c0[LANES];
+	real_t c1[LANES];
+	real_t c2[LANES];
+	for (int32_t lane = 0; lane < LANES; lane++) {
+		real_t Sxx2 = Sxx[lane] * Sxx[lane];
+		real_t Syy2 = Syy[lane] * Syy[lane];
+		real_t Szz2 = Szz[lane] * Szz[lane];
+
+		real_t Sxy2 = Sxy[lane] * Sxy[lane];
+		real_t Syz2 = Syz[lane] * Syz[lane];
+		real_t Sxz2 = Sxz[lane] * Sxz[lane];
+
+		real_t Syx2 = Syx[lane] * Syx[lane];
+		real_t Szy2 = Szy[lane] * Szy[lane];
+		real_t Szx2 = Szx[lane] * Szx[lane];
+
+		real_t SyzSzymSyySzz2 = 2.0 * (Syz[lane] * Szy[lane] - Syy[lane] * Szz[lane]);
+		real_t Sxx2Syy2Szz2Syz2Szy2 = Syy2 + Szz2 - Sxx2 + Syz2 + Szy2;
+
+		c2[lane] = -2.0 * (Sxx2 + Syy2 + Szz2 + Sxy2 + Syx2 + Sxz2 + Szx2 + Syz2 + Szy2);
+		c1[lane] = 8.0 * (Sxx[lane] * Syz[lane] * Szy[lane] + Syy[lane] * Szx[lane] * Sxz[lane] + Szz[lane] * Sxy[lane] * Syx[lane] -
+								 Sxx[lane] * Syy[lane] * Szz[lane] - Syz[lane] * Szx[lane] * Sxy[lane] - Szy[lane] * Syx[lane] * Sxz[lane]);
+
+		real_t SxzpSzx = Sxz[lane] + Szx[lane];
+		real_t SyzpSzy = Syz[lane] + Szy[lane];
+		real_t SxypSyx = Sxy[lane] + Syx[lane];
+		real_t SyzmSzy = Syz[lane] - Szy[lane];
+		real_t SxzmSzx = Sxz[lane] - Szx[lane];
+		real_t SxymSyx = Sxy[lane] - Syx[lane];
+		real_t SxxpSyy = Sxx[lane] + Syy[lane];
+		real_t SxxmSyy = Sxx[lane] - Syy[lane];
+
+		real_t Sxy2Sxz2Syx2Szx2 = Sxy2 + Sxz2 - Syx2 - Szx2;
+
+		c0[lane] = Sxy2Sxz2Syx2Szx2 * Sxy2Sxz2Syx2Szx2 +
+				(Sxx2Syy2Szz2Syz2Szy2 + SyzSzymSyySzz2) * (Sxx2Syy2Szz2Syz2Szy2 - SyzSzymSyySzz2) +
+				(-(SxzpSzx) * (SyzmSzy) + (SxymSyx) * (SxxmSyy - Szz[lane])) * (-(SxzmSzx) * (SyzpSzy) + (SxymSyx) * (SxxmSyy + Szz[lane])) +
+				(-(SxzpSzx) * (SyzpSzy) - (SxypSyx) * (SxxpSyy - Szz[lane])) * (-(SxzmSzx) * (SyzmSzy) - (SxypSyx) * (SxxpSyy + Szz[lane])) +
+				(+(SxypSyx) * (SyzpSzy) + (SxzpSzx) * (SxxmSyy + Szz[lane])) * (-(SxymSyx) * (SyzmSzy) + (SxzpSzx) * (SxxpSyy + Szz[lane])) +
+				(+(SxypSyx) * (SyzmSzy) + (SxzmSzx) * (SxxmSyy - Szz[lane])) * (-(SxymSyx) * (SyzpSzy) + (SxzmSzx) * (SxxpSyy - Szz[lane]));
+	}
+
+	/* Newton-Raphson, in lockstep until every lane has converged */
+	// Lanes are switched off by a factor instead of a branch, so the inner loop stays vectorizable.
+	// A converged or stalled lane takes zero steps from then on, as if the scalar code had stopped.
+	real_t active[LANES];
+	for (int32_t lane = 0; lane < LANES; lane++) {
+		active[lane] = real_t((p_mask >> lane) & 1);
+	}
+	for (int32_t i = 0; i < max_iterations; ++i) {
+		real_t remaining = 0.0;
+		for (int32_t lane = 0; lane < LANES; lane++) {
+			real_t eignv = r_e0[lane];
+			real_t x2 = eignv * eignv;
+			real_t b = (x2 + c2[lane]) * eignv;
+			real_t a = b + c1[lane];
+			real_t d = (2.0 * x2 * eignv + b + a);
+			real_t step = active[lane] * real_t(d != 0.0);
+			real_t delta = step * (a * eignv + c0[lane]) / (step * d + (1.0 - step));
+			eignv -= delta;
+			r_e0[lane] = eignv;
+			active[lane] = step * real_t(Math::abs(delta) >= Math::abs(eval_prec * eignv));
+			remaining += active[lane];
+		}
+		if (remaining == 0.0) {
+			break;
+		}
+	}
+}
+
+Quat QCPLanes::calc_rotation(int32_t p_lane, real_t p_eigenv) {
+	lane_qcp.Sxx = Sxx[p_lane];
+	lane_qcp.Syy = Syy[p_lane];
+	lane_qcp.Szz = Szz[p_lane];
+	lane_qcp.SxzpSzx = Sxz[p_lane] + Szx[p_lane];
+	lane_qcp.SyzpSzy = Syz[p_lane] + Szy[p_lane];
+	lane_qcp.SxypSyx = Sxy[p_lane] + Syx[p_lane];
+	lane_qcp.SyzmSzy = Syz[p_lane] - Szy[p_lane];
+	lane_qcp.SxzmSzx = Sxz[p_lane] - Szx[p_lane];
+	lane_qcp.SxymSyx = Sxy[p_lane] - Syx[p_lane];
+	lane_qcp.SxxpSyy = Sxx[p_lane] + Syy[p_lane];
+	lane_qcp.SxxmSyy = Sxx[p_lane] - Syy[p_lane];
+	return lane_qcp.calc_rotation(p_eigenv);
+}
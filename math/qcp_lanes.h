@@ -0,0 +1,70 @@
+/*************************************************************************/
+/*  qcp_lanes.h                                                          */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2019 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2019 Godot Engine contributors (cf. AUTHORS.md)    */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef QCP_LANES_H
+#define QCP_LANES_H
+
+#include "qcp.h"
+
+// QCP for several independent problems of the same size at once. The inputs are stored lane
+// by lane inside every heading, so the accumulation, the characteristic polynomial and its
+// Newton-Raphson root run as branch-free loops over the lanes, which the compiler turns into SIMD code.
+class QCPLanes {
+public:
+	static const int32_t LANES = 4;
+
+	struct Heading {
+		real_t x[LANES];
+		real_t y[LANES];
+		real_t z[LANES];
+	};
+
+	struct Weight {
+		real_t w[LANES];
+	};
+
+private:
+	real_t eval_prec = CMP_EPSILON;
+	int32_t max_iterations = 15;
+	real_t Sxx[LANES], Sxy[LANES], Sxz[LANES], Syx[LANES], Syy[LANES], Syz[LANES], Szx[LANES], Szy[LANES], Szz[LANES];
+	// Extracts every lane's rotation with the scalar code, it branches too much to gain from lanes.
+	QCP lane_qcp;
+
+	void inner_product(const Heading *p_coords1, const Heading *p_coords2, const Weight *p_weights, int32_t p_count, real_t *r_e0);
+	void calc_eigenvalues(real_t *r_e0, uint32_t p_mask);
+	Quat calc_rotation(int32_t p_lane, real_t p_eigenv);
+
+public:
+	// Lanes outside p_mask are computed on whatever they hold, and their results are not written.
+	void calc_optimal_rotations(const Heading *p_coords1, const Heading *p_coords2, const Weight *p_weights,
+			int32_t p_count, uint32_t p_mask, Quat *r_quats);
+};
+
+#endif // QCP_LANES_H
@@ -29,11 +29,33 @@
 /*************************************************************************/
 
 #include "register_types.h"
+#include "core/config/engine.h"
+#include "core/os/os.h"
+#include "ewbik_server.h"
+#include "ik_task_scheduler.h"
 #include "skeleton_modification_3d_ewbik.h"
 
+static EWBIKServer *ewbik_server = nullptr;
+static IKTaskScheduler *ik_task_scheduler = nullptr;
+
 void register_ewbik_types() {
 	ClassDB::register_class<SkeletonModification3DEWBIK>();
+	// Only the singleton below may exist, scripts reach it through Engine.
+	ClassDB::register_virtual_class<EWBIKServer>();
+	ewbik_server = memnew(EWBIKServer);
+	// Created up front, so rigs never race to create it from several threads.
+	ik_task_scheduler = memnew(IKTaskScheduler(OS::get_singleton()->get_processor_count()));
+	Engine::get_singleton()->add_singleton(Engine::Singleton("EWBIKServer", EWBIKServer::get_singleton()));
 }
 
 void unregister_ewbik_types() {
+	if (ewbik_server) {
+		Engine::get_singleton()->remove_singleton("EWBIKServer");
+		memdelete(ewbik_server);
+		ewbik_server = nullptr;
+	}
+	if (ik_task_scheduler) {
+		memdelete(ik_task_scheduler);
+		ik_task_scheduler = nullptr;
+	}
 }
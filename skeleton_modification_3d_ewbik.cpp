@@ -29,23 +29,349 @@
 /*************************************************************************/
 
 #include "skeleton_modification_3d_ewbik.h"
+#include "core/os/os.h"
+#include "core/templates/hashfuncs.h"
 #include "core/templates/map.h"
+#include "ewbik_server.h"
+#include "ik_task_scheduler.h"
+#include "scene/3d/camera_3d.h"
+#include "scene/main/viewport.h"
 
 int32_t SkeletonModification3DEWBIK::get_ik_iterations() const {
 	return ik_iterations;
 }
 
 void SkeletonModification3DEWBIK::set_ik_iterations(int32_t p_iterations) {
+	finish_async_solve();
 	ERR_FAIL_COND_MSG(p_iterations <= 0, "EWBIK max iterations must be at least one. Set enabled to false to disable the EWBIK simulation.");
 	ik_iterations = p_iterations;
+	has_solution = false;
 	calc_done = false;
 }
 
+int32_t SkeletonModification3DEWBIK::get_stabilization_passes() const {
+	return stabilization_passes;
+}
+
+void SkeletonModification3DEWBIK::set_stabilization_passes(int32_t p_passes) {
+	finish_async_solve();
+	ERR_FAIL_COND_MSG(p_passes < 0, "EWBIK stabilization passes can't be negative.");
+	stabilization_passes = p_passes;
+	has_solution = false;
+	calc_done = false;
+}
+
+real_t SkeletonModification3DEWBIK::get_time_budget_millisecond() const {
+	return time_budget_millisecond;
+}
+
+void SkeletonModification3DEWBIK::set_time_budget_millisecond(real_t p_budget) {
+	finish_async_solve();
+	ERR_FAIL_COND_MSG(p_budget < 0.0, "EWBIK time budget can't be negative. Set it to zero to only use the iteration count.");
+	time_budget_millisecond = p_budget;
+	has_solution = false;
+	calc_done = false;
+}
+
+real_t SkeletonModification3DEWBIK::get_convergence_tolerance() const {
+	return convergence_tolerance;
+}
+
+void SkeletonModification3DEWBIK::set_convergence_tolerance(real_t p_tolerance) {
+	finish_async_solve();
+	convergence_tolerance = MAX(p_tolerance, 0.0);
+	has_solution = false;
+	calc_done = false;
+}
+
+bool SkeletonModification3DEWBIK::get_scale_iterations_by_strength() const {
+	return scale_iterations_by_strength;
+}
+
+void SkeletonModification3DEWBIK::set_scale_iterations_by_strength(bool p_enabled) {
+	finish_async_solve();
+	scale_iterations_by_strength = p_enabled;
+	has_solution = false;
+	calc_done = false;
+}
+
+real_t SkeletonModification3DEWBIK::get_over_relaxation() const {
+	return over_relaxation;
+}
+
+void SkeletonModification3DEWBIK::set_over_relaxation(real_t p_factor) {
+	finish_async_solve();
+	ERR_FAIL_COND_MSG(p_factor < 1.0 || p_factor >= 2.0, "EWBIK over-relaxation must be in the [1, 2) range.");
+	over_relaxation = p_factor;
+	has_solution = false;
+	calc_done = false;
+}
+
+int32_t SkeletonModification3DEWBIK::get_solver_backend() const {
+	return solver_backend;
+}
+
+void SkeletonModification3DEWBIK::set_solver_backend(int32_t p_backend) {
+	finish_async_solve();
+	ERR_FAIL_INDEX_MSG(p_backend, IKSolverBackend::TYPE_MAX, "Unknown EWBIK solver backend.");
+	solver_backend = IKSolverBackend::Type(p_backend);
+	for (int32_t root_i = 0; root_i < segmented_skeletons.size(); root_i++) {
+		segmented_skeletons[root_i]->update_solver_backend(solver_backend);
+	}
+	has_solution = false;
+	calc_done = false;
+}
+
+bool SkeletonModification3DEWBIK::get_parallel_solve() const {
+	return parallel_solve;
+}
+
+void SkeletonModification3DEWBIK::set_parallel_solve(bool p_enabled) {
+	finish_async_solve();
+	parallel_solve = p_enabled;
+}
+
+bool SkeletonModification3DEWBIK::get_async_solve() const {
+	return async_solve;
+}
+
+void SkeletonModification3DEWBIK::set_async_solve(bool p_enabled) {
+	async_solve = p_enabled;
+	if (!async_solve) {
+		finish_async_solve();
+		// The synchronous solves write the overrides themselves from now on.
+		front_rotations.clear();
+		calc_done = false;
+	}
+}
+
+bool SkeletonModification3DEWBIK::get_server_solve() const {
+	return server_solve;
+}
+
+void SkeletonModification3DEWBIK::set_server_solve(bool p_enabled) {
+	finish_async_solve();
+	EWBIKServer *server = EWBIKServer::get_singleton();
+	if (!server) {
+		// Without the server the rig keeps solving on its own.
+		server_solve = false;
+		if (p_enabled) {
+			WARN_PRINT("EWBIK server isn't available, the rig is solved on its own.");
+		}
+		return;
+	}
+	server_solve = p_enabled;
+	if (server_solve && !server_rig.is_valid()) {
+		server_rig = server->rig_create(this);
+	} else if (!server_solve && server_rig.is_valid()) {
+		server->rig_free(server_rig);
+		server_rig = RID();
+	}
+}
+
+bool SkeletonModification3DEWBIK::get_crowd_solve() const {
+	return crowd_solve;
+}
+
+void SkeletonModification3DEWBIK::set_crowd_solve(bool p_enabled) {
+	finish_async_solve();
+	crowd_solve = p_enabled;
+}
+
+uint32_t SkeletonModification3DEWBIK::get_crowd_signature() const {
+	return crowd_signature;
+}
+
+bool SkeletonModification3DEWBIK::is_crowd_packable() const {
+	// The lanes run plain QCP iterations only, anything else keeps a task of its own.
+	if (!crowd_solve || is_dirty || stabilization_passes > 0 || coarse_segment_bones > 1 || segmented_skeletons.is_empty()) {
+		return false;
+	}
+	for (int32_t root_i = 0; root_i < segmented_skeletons.size(); root_i++) {
+		if (!segmented_skeletons[root_i]->is_lane_compatible()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int32_t SkeletonModification3DEWBIK::get_coarse_segment_bones() const {
+	return coarse_segment_bones;
+}
+
+void SkeletonModification3DEWBIK::set_coarse_segment_bones(int32_t p_bones) {
+	finish_async_solve();
+	ERR_FAIL_COND_MSG(p_bones < 0, "EWBIK coarse segment bones can't be negative. Set it to zero or one to solve at full resolution only.");
+	coarse_segment_bones = p_bones;
+	has_solution = false;
+	calc_done = false;
+}
+
+int32_t SkeletonModification3DEWBIK::get_coarse_iterations() const {
+	return coarse_iterations;
+}
+
+void SkeletonModification3DEWBIK::set_coarse_iterations(int32_t p_iterations) {
+	finish_async_solve();
+	ERR_FAIL_COND_MSG(p_iterations < 0, "EWBIK coarse iterations can't be negative.");
+	coarse_iterations = p_iterations;
+	has_solution = false;
+	calc_done = false;
+}
+
+bool SkeletonModification3DEWBIK::get_warm_start() const {
+	return warm_start;
+}
+
+void SkeletonModification3DEWBIK::set_warm_start(bool p_enabled) {
+	finish_async_solve();
+	warm_start = p_enabled;
+	has_solution = false;
+	calc_done = false;
+}
+
+real_t SkeletonModification3DEWBIK::get_warm_start_blend() const {
+	return warm_start_blend;
+}
+
+void SkeletonModification3DEWBIK::set_warm_start_blend(real_t p_blend) {
+	finish_async_solve();
+	warm_start_blend = CLAMP(p_blend, 0.0, 1.0);
+	has_solution = false;
+	calc_done = false;
+}
+
+real_t SkeletonModification3DEWBIK::get_warm_start_reset_distance() const {
+	return warm_start_reset_distance;
+}
+
+void SkeletonModification3DEWBIK::set_warm_start_reset_distance(real_t p_distance) {
+	finish_async_solve();
+	warm_start_reset_distance = MAX(p_distance, 0.0);
+}
+
+bool SkeletonModification3DEWBIK::is_warm_started() {
+	finish_async_solve();
+	return warm_started;
+}
+
+int32_t SkeletonModification3DEWBIK::get_iterations_per_frame() const {
+	return iterations_per_frame;
+}
+
+void SkeletonModification3DEWBIK::set_iterations_per_frame(int32_t p_iterations) {
+	finish_async_solve();
+	ERR_FAIL_COND_MSG(p_iterations < 0, "EWBIK iterations per frame can't be negative. Set it to zero to solve in a single frame.");
+	iterations_per_frame = p_iterations;
+	pending_iterations = 0;
+	has_solution = false;
+	calc_done = false;
+}
+
+real_t SkeletonModification3DEWBIK::get_dirty_position_epsilon() const {
+	return dirty_position_epsilon;
+}
+
+void SkeletonModification3DEWBIK::set_dirty_position_epsilon(real_t p_epsilon) {
+	finish_async_solve();
+	dirty_position_epsilon = MAX(p_epsilon, 0.0);
+}
+
+real_t SkeletonModification3DEWBIK::get_dirty_angle_epsilon() const {
+	return dirty_angle_epsilon;
+}
+
+void SkeletonModification3DEWBIK::set_dirty_angle_epsilon(real_t p_epsilon) {
+	finish_async_solve();
+	dirty_angle_epsilon = MAX(p_epsilon, 0.0);
+}
+
+real_t SkeletonModification3DEWBIK::get_lod_importance() const {
+	return lod_importance;
+}
+
+void SkeletonModification3DEWBIK::set_lod_importance(real_t p_importance) {
+	finish_async_solve();
+	lod_importance = CLAMP(p_importance, 0.0, 1.0);
+}
+
+real_t SkeletonModification3DEWBIK::get_lod_distance_near() const {
+	return lod_distance_near;
+}
+
+void SkeletonModification3DEWBIK::set_lod_distance_near(real_t p_distance) {
+	finish_async_solve();
+	lod_distance_near = MAX(p_distance, 0.0);
+}
+
+real_t SkeletonModification3DEWBIK::get_lod_distance_far() const {
+	return lod_distance_far;
+}
+
+void SkeletonModification3DEWBIK::set_lod_distance_far(real_t p_distance) {
+	finish_async_solve();
+	lod_distance_far = MAX(p_distance, 0.0);
+}
+
+real_t SkeletonModification3DEWBIK::get_lod_bounds_radius() const {
+	return lod_bounds_radius;
+}
+
+void SkeletonModification3DEWBIK::set_lod_bounds_radius(real_t p_radius) {
+	finish_async_solve();
+	lod_bounds_radius = MAX(p_radius, 0.0);
+}
+
+int32_t SkeletonModification3DEWBIK::get_lod_max_frame_skip() const {
+	return lod_max_frame_skip;
+}
+
+void SkeletonModification3DEWBIK::set_lod_max_frame_skip(int32_t p_frames) {
+	finish_async_solve();
+	ERR_FAIL_COND_MSG(p_frames < 0, "EWBIK level of detail frame skip can't be negative.");
+	lod_max_frame_skip = p_frames;
+}
+
+real_t SkeletonModification3DEWBIK::get_lod_factor() const {
+	return lod_factor;
+}
+
+int32_t SkeletonModification3DEWBIK::get_pending_iterations() {
+	finish_async_solve();
+	return pending_iterations;
+}
+
+int32_t SkeletonModification3DEWBIK::get_last_iteration_count() {
+	finish_async_solve();
+	return last_iteration_count;
+}
+
+int32_t SkeletonModification3DEWBIK::get_last_coarse_iteration_count() {
+	finish_async_solve();
+	return last_coarse_iteration_count;
+}
+
+real_t SkeletonModification3DEWBIK::get_budget_used_millisecond() {
+	finish_async_solve();
+	return budget_used_millisecond;
+}
+
+bool SkeletonModification3DEWBIK::is_converged() {
+	finish_async_solve();
+	return converged;
+}
+
+bool SkeletonModification3DEWBIK::is_target_reachable() {
+	finish_async_solve();
+	return targets_reachable;
+}
+
 String SkeletonModification3DEWBIK::get_root_bone() const {
 	return root_bone;
 }
 
 void SkeletonModification3DEWBIK::set_root_bone(const String &p_root_bone) {
+	finish_async_solve();
 	root_bone = p_root_bone;
 	if (skeleton)
 		root_bone_index = skeleton->find_bone(root_bone);
@@ -53,18 +379,114 @@ void SkeletonModification3DEWBIK::set_root_bone(const String &p_root_bone) {
 	is_dirty = true;
 }
 
+PackedStringArray SkeletonModification3DEWBIK::get_frozen_bones() const {
+	return frozen_bones;
+}
+
+void SkeletonModification3DEWBIK::set_frozen_bones(const PackedStringArray &p_bones) {
+	finish_async_solve();
+	frozen_bones = p_bones;
+	is_dirty = true;
+}
+
+void SkeletonModification3DEWBIK::set_twist_bone_count(int32_t p_count) {
+	finish_async_solve();
+	ERR_FAIL_COND_MSG(p_count < 0, "EWBIK twist bone count can't be negative.");
+	twist_bones.resize(p_count);
+	is_dirty = true;
+	notify_property_list_changed();
+}
+
+int32_t SkeletonModification3DEWBIK::get_twist_bone_count() const {
+	return twist_bones.size();
+}
+
+void SkeletonModification3DEWBIK::add_twist_bone(const String &p_name, const String &p_driver, real_t p_fraction) {
+	finish_async_solve();
+	TwistBone twist;
+	twist.name = p_name;
+	twist.driver = p_driver;
+	twist.fraction = p_fraction;
+	twist_bones.push_back(twist);
+	is_dirty = true;
+	notify_property_list_changed();
+}
+
+void SkeletonModification3DEWBIK::set_twist_bone(int32_t p_index, const String &p_name) {
+	finish_async_solve();
+	ERR_FAIL_INDEX(p_index, twist_bones.size());
+	twist_bones.write[p_index].name = p_name;
+	is_dirty = true;
+}
+
+String SkeletonModification3DEWBIK::get_twist_bone(int32_t p_index) const {
+	ERR_FAIL_INDEX_V(p_index, twist_bones.size(), String());
+	return twist_bones[p_index].name;
+}
+
+void SkeletonModification3DEWBIK::set_twist_bone_driver(int32_t p_index, const String &p_driver) {
+	finish_async_solve();
+	ERR_FAIL_INDEX(p_index, twist_bones.size());
+	twist_bones.write[p_index].driver = p_driver;
+	is_dirty = true;
+}
+
+String SkeletonModification3DEWBIK::get_twist_bone_driver(int32_t p_index) const {
+	ERR_FAIL_INDEX_V(p_index, twist_bones.size(), String());
+	return twist_bones[p_index].driver;
+}
+
+void SkeletonModification3DEWBIK::set_twist_bone_fraction(int32_t p_index, real_t p_fraction) {
+	finish_async_solve();
+	ERR_FAIL_INDEX(p_index, twist_bones.size());
+	twist_bones.write[p_index].fraction = p_fraction;
+	is_dirty = true;
+}
+
+real_t SkeletonModification3DEWBIK::get_twist_bone_fraction(int32_t p_index) const {
+	ERR_FAIL_INDEX_V(p_index, twist_bones.size(), 0.0);
+	return twist_bones[p_index].fraction;
+}
+
 BoneId SkeletonModification3DEWBIK::get_root_bone_index() const {
 	return root_bone_index;
 }
 
+int32_t SkeletonModification3DEWBIK::get_root_count() const {
+	return segmented_skeletons.size();
+}
+
 void SkeletonModification3DEWBIK::set_root_bone_index(BoneId p_index) {
+	finish_async_solve();
 	root_bone_index = p_index;
 	if (skeleton)
 		root_bone = skeleton->get_bone_name(p_index);
 	is_dirty = true;
 }
 
+void SkeletonModification3DEWBIK::set_effector_weight_threshold(real_t p_threshold) {
+	finish_async_solve();
+	ERR_FAIL_COND_MSG(p_threshold < 0.0, "EWBIK effector weight threshold can't be negative.");
+	effector_weight_threshold = p_threshold;
+	is_dirty = true;
+}
+
+real_t SkeletonModification3DEWBIK::get_effector_weight_threshold() const {
+	return effector_weight_threshold;
+}
+
+Dictionary SkeletonModification3DEWBIK::get_heading_report() const {
+	// Bone name to the number of headings it is solved against, without and with the weight threshold.
+	Dictionary report;
+	ERR_FAIL_COND_V_MSG(segmented_skeletons.is_empty(), report, "EWBIK skeleton segments haven't been built yet.");
+	for (int32_t root_i = 0; root_i < segmented_skeletons.size(); root_i++) {
+		segmented_skeletons[root_i]->get_heading_counts(report);
+	}
+	return report;
+}
+
 void SkeletonModification3DEWBIK::set_effector_count(int32_t p_value) {
+	finish_async_solve();
 	multi_effector.resize(p_value);
 	for (int32_t i = effector_count; i < p_value; i++) {
 		Ref<IKBone3D> bone = Ref<IKBone3D>(memnew(IKBone3D()));
@@ -83,6 +505,7 @@ int32_t SkeletonModification3DEWBIK::get_effector_count() const {
 
 void SkeletonModification3DEWBIK::add_effector(const String &p_name, const NodePath &p_target_node, bool p_use_node_rot,
 		const Transform &p_target_xform) {
+	finish_async_solve();
 	Ref<IKBone3D> effector_bone = Ref<IKBone3D>(memnew(IKBone3D(p_name, skeleton)));
 	Ref<IKEffector3D> effector = Ref<IKEffector3D>(memnew(IKEffector3D(effector_bone)));
 	effector->set_target_node(p_target_node);
@@ -102,6 +525,7 @@ Ref<IKBone3D> SkeletonModification3DEWBIK::get_effector(int32_t p_index) const {
 }
 
 void SkeletonModification3DEWBIK::set_effector(int32_t p_index, const Ref<IKBone3D> &p_effector) {
+	finish_async_solve();
 	ERR_FAIL_COND(p_effector.is_null());
 	ERR_FAIL_INDEX(p_index, multi_effector.size());
 	multi_effector.write[p_index] = p_effector;
@@ -110,6 +534,7 @@ void SkeletonModification3DEWBIK::set_effector(int32_t p_index, const Ref<IKBone
 }
 
 void SkeletonModification3DEWBIK::set_effector_bone_index(int32_t p_effector_index, int32_t p_bone_index) {
+	finish_async_solve();
 	multi_effector.write[p_effector_index]->set_bone_id(p_bone_index);
 	is_dirty = true;
 }
@@ -119,6 +544,7 @@ BoneId SkeletonModification3DEWBIK::get_effector_bone_index(int32_t p_effector_i
 }
 
 void SkeletonModification3DEWBIK::set_effector_bone(int32_t p_effector_index, const String &p_bone) {
+	finish_async_solve();
 	if (skeleton) {
 		BoneId bone = skeleton->find_bone(p_bone);
 		multi_effector.write[p_effector_index]->set_bone_id(bone);
@@ -134,6 +560,7 @@ String SkeletonModification3DEWBIK::get_effector_bone(int32_t p_effector_index)
 }
 
 void SkeletonModification3DEWBIK::set_effector_target_nodepath(int32_t p_index, const NodePath &p_target_node) {
+	finish_async_solve();
 	multi_effector.write[p_index]->get_effector()->set_target_node(p_target_node);
 	calc_done = false;
 }
@@ -142,137 +569,633 @@ NodePath SkeletonModification3DEWBIK::get_effector_target_nodepath(int32_t p_ind
 	return multi_effector[p_index]->get_effector()->get_target_node();
 }
 
-void SkeletonModification3DEWBIK::set_effector_target_transform(int32_t p_index, const Transform &p_target_transform) {
-	multi_effector.write[p_index]->get_effector()->set_target_transform(p_target_transform);
-	calc_done = false;
+void SkeletonModification3DEWBIK::set_effector_target_transform(int32_t p_index, const Transform &p_target_transform) {
+	finish_async_solve();
+	multi_effector.write[p_index]->get_effector()->set_target_transform(p_target_transform);
+	calc_done = false;
+}
+
+Transform SkeletonModification3DEWBIK::get_effector_target_transform(int32_t p_index) const {
+	return multi_effector[p_index]->get_effector()->get_target_transform();
+}
+
+void SkeletonModification3DEWBIK::set_effector_use_node_rotation(int32_t p_index, bool p_use_node_rot) {
+	finish_async_solve();
+	multi_effector.write[p_index]->get_effector()->set_use_target_node_rotation(p_use_node_rot);
+	calc_done = false;
+}
+
+bool SkeletonModification3DEWBIK::get_effector_use_node_rotation(int32_t p_index) const {
+	return multi_effector[p_index]->get_effector()->get_use_target_node_rotation();
+}
+
+void SkeletonModification3DEWBIK::set_effector_enabled(int32_t p_index, bool p_enabled) {
+	finish_async_solve();
+	ERR_FAIL_INDEX(p_index, multi_effector.size());
+	multi_effector.write[p_index]->get_effector()->set_enabled(p_enabled);
+	calc_done = false;
+}
+
+bool SkeletonModification3DEWBIK::is_effector_enabled(int32_t p_index) const {
+	ERR_FAIL_INDEX_V(p_index, multi_effector.size(), false);
+	return multi_effector[p_index]->get_effector()->is_enabled();
+}
+
+void SkeletonModification3DEWBIK::set_effector_weight(int32_t p_index, real_t p_weight) {
+	finish_async_solve();
+	ERR_FAIL_INDEX(p_index, multi_effector.size());
+	ERR_FAIL_COND_MSG(p_weight < 0.0, "EWBIK effector weight can't be negative.");
+	multi_effector.write[p_index]->get_effector()->set_weight(p_weight);
+	weights_dirty = true;
+	calc_done = false;
+}
+
+real_t SkeletonModification3DEWBIK::get_effector_weight(int32_t p_index) const {
+	ERR_FAIL_INDEX_V(p_index, multi_effector.size(), 0.0);
+	return multi_effector[p_index]->get_effector()->get_weight();
+}
+
+void SkeletonModification3DEWBIK::set_effector_solver_backend(int32_t p_index, int32_t p_backend) {
+	finish_async_solve();
+	ERR_FAIL_INDEX(p_index, multi_effector.size());
+	ERR_FAIL_COND_MSG(p_backend < -1 || p_backend >= IKSolverBackend::TYPE_MAX, "Unknown EWBIK solver backend. Use -1 to inherit the modification's backend.");
+	multi_effector.write[p_index]->get_effector()->set_solver_backend(p_backend);
+	for (int32_t root_i = 0; root_i < segmented_skeletons.size(); root_i++) {
+		segmented_skeletons[root_i]->update_solver_backend(solver_backend);
+	}
+	has_solution = false;
+	calc_done = false;
+}
+
+int32_t SkeletonModification3DEWBIK::get_effector_solver_backend(int32_t p_index) const {
+	ERR_FAIL_INDEX_V(p_index, multi_effector.size(), -1);
+	return multi_effector[p_index]->get_effector()->get_solver_backend();
+}
+
+void SkeletonModification3DEWBIK::set_effector_depth_falloff(int32_t p_index, real_t p_falloff) {
+	finish_async_solve();
+	multi_effector.write[p_index]->get_effector()->set_depth_falloff(p_falloff);
+	// Falloffs decide which headings the parent chains carry, so they need recompiling.
+	is_dirty = true;
+}
+
+real_t SkeletonModification3DEWBIK::get_effector_depth_falloff(int32_t p_index) const {
+	return multi_effector[p_index]->get_effector()->get_depth_falloff();
+}
+
+void SkeletonModification3DEWBIK::set_effector_budget(int32_t p_index, real_t p_budget) {
+	finish_async_solve();
+	multi_effector.write[p_index]->get_effector()->set_budget(p_budget);
+	calc_done = false;
+}
+
+real_t SkeletonModification3DEWBIK::get_effector_budget(int32_t p_index) const {
+	return multi_effector[p_index]->get_effector()->get_budget();
+}
+
+void SkeletonModification3DEWBIK::set_effector_lod_threshold(int32_t p_index, real_t p_threshold) {
+	finish_async_solve();
+	multi_effector.write[p_index]->get_effector()->set_lod_threshold(p_threshold);
+	calc_done = false;
+}
+
+real_t SkeletonModification3DEWBIK::get_effector_lod_threshold(int32_t p_index) const {
+	return multi_effector[p_index]->get_effector()->get_lod_threshold();
+}
+
+void SkeletonModification3DEWBIK::set_effector_update_divider(int32_t p_index, int32_t p_divider) {
+	finish_async_solve();
+	ERR_FAIL_COND_MSG(p_divider < 1, "EWBIK effector update divider must be at least one.");
+	multi_effector.write[p_index]->get_effector()->set_update_divider(p_divider);
+	calc_done = false;
+}
+
+int32_t SkeletonModification3DEWBIK::get_effector_update_divider(int32_t p_index) const {
+	return multi_effector[p_index]->get_effector()->get_update_divider();
+}
+
+real_t SkeletonModification3DEWBIK::get_effector_reach(int32_t p_index) const {
+	ERR_FAIL_INDEX_V(p_index, multi_effector.size(), -1.0);
+	ERR_FAIL_COND_V_MSG(segmented_skeletons.is_empty(), -1.0, "EWBIK skeleton segments haven't been built yet.");
+	Ref<IKBoneChain> chain = find_segment_containing(multi_effector[p_index]);
+	ERR_FAIL_COND_V(chain.is_null(), -1.0);
+	return chain->get_reach();
+}
+
+bool SkeletonModification3DEWBIK::is_effector_reachable(int32_t p_index) {
+	finish_async_solve();
+	ERR_FAIL_INDEX_V(p_index, multi_effector.size(), true);
+	ERR_FAIL_COND_V_MSG(segmented_skeletons.is_empty(), true, "EWBIK skeleton segments haven't been built yet.");
+	Ref<IKBoneChain> chain = find_segment_containing(multi_effector[p_index]);
+	ERR_FAIL_COND_V(chain.is_null(), true);
+	// Measured against the goal and root position of the last solve.
+	return chain->is_reachable();
+}
+
+Vector<Ref<IKBone3D>> SkeletonModification3DEWBIK::get_bone_effectors() const {
+	return multi_effector;
+}
+
+int32_t SkeletonModification3DEWBIK::find_effector(const String &p_name) const {
+	BoneId bone = skeleton->find_bone(p_name);
+	for (int32_t effector_i = 0; effector_i < multi_effector.size(); effector_i++) {
+		if (multi_effector[effector_i].is_valid() && multi_effector[effector_i]->get_bone_id() == bone) {
+			return effector_i;
+		}
+	}
+	return -1;
+}
+
+void SkeletonModification3DEWBIK::remove_effector(int32_t p_index) {
+	finish_async_solve();
+	ERR_FAIL_INDEX(p_index, multi_effector.size());
+	multi_effector.remove(p_index);
+	effector_count--;
+
+	is_dirty = true;
+}
+
+void SkeletonModification3DEWBIK::execute(float delta) {
+	ERR_FAIL_COND_MSG(!stack || !is_setup || skeleton == nullptr,
+			"Modification is not setup and therefore cannot execute!");
+	if (!enabled)
+		return;
+
+	if (is_dirty) {
+		update_skeleton();
+	}
+	execution_error_found = false;
+	// The solve started on the last frame still reads the level of detail and the settings.
+	finish_async_solve();
+
+	// Frozen characters keep their last pose, which the persistent overrides already hold.
+	lod_factor = update_lod_factor();
+	if (lod_factor <= 0.0) {
+		return;
+	}
+	int32_t frame_skip = int32_t(Math::round((1.0 - lod_factor) * lod_max_frame_skip));
+	if (lod_frame++ % (frame_skip + 1) != 0) {
+		return;
+	}
+
+	if (async_solve) {
+		// The solve started here overlaps the rest of the frame, and its result shows up on the next one.
+		if (!is_calc_done()) {
+			if (gather_solve(stack->get_strength())) {
+				IKTaskScheduler *scheduler = IKTaskScheduler::get_singleton();
+				async_pending = true;
+				if (scheduler) {
+					scheduler->submit(async_task, _async_solve, this);
+				} else {
+					solve_gathered();
+				}
+			} else {
+				complete_solve(false);
+			}
+		}
+		// Written again every frame, since a new gather resets the overrides.
+		scatter_rotations(front_rotations, front_strength);
+	} else if (!is_calc_done()) {
+		if (server_rig.is_valid()) {
+			// Solved later this frame, together with every other rig the server batches.
+			EWBIKServer *server = EWBIKServer::get_singleton();
+			server->rig_queue_solve(server_rig, stack->get_strength());
+			if (has_later_modifications()) {
+				// The rest of the stack reads the solved pose, so it can't wait for the deferred batch.
+				server->solve_batch();
+			}
+		} else {
+			solve(stack->get_strength());
+		}
+	}
+}
+
+bool SkeletonModification3DEWBIK::has_later_modifications() const {
+	bool found = false;
+	for (int32_t modification_i = 0; modification_i < stack->get_modification_count(); modification_i++) {
+		Ref<SkeletonModification3D> modification = stack->get_modification(modification_i);
+		if (found && modification.is_valid() && modification->get_enabled()) {
+			return true;
+		}
+		found = found || modification.ptr() == this;
+	}
+	return false;
+}
+
+real_t SkeletonModification3DEWBIK::update_lod_factor() const {
+	real_t factor = lod_importance;
+	if (lod_distance_far <= 0.0 || !skeleton->is_inside_tree()) {
+		return factor;
+	}
+	Viewport *viewport = skeleton->get_viewport();
+	Camera3D *camera = viewport ? viewport->get_camera() : nullptr;
+	if (!camera) {
+		return factor;
+	}
+
+	Vector3 origin = skeleton->get_global_transform().origin;
+	Vector<Plane> frustum = camera->get_frustum();
+	for (int32_t plane_i = 0; plane_i < frustum.size(); plane_i++) {
+		if (frustum[plane_i].distance_to(origin) > lod_bounds_radius) {
+			return 0.0;
+		}
+	}
+
+	real_t distance = camera->get_global_transform().origin.distance_to(origin);
+	real_t range = MAX(lod_distance_far - lod_distance_near, CMP_EPSILON);
+	return factor * (1.0 - CLAMP((distance - lod_distance_near) / range, 0.0, 1.0));
+}
+
+void SkeletonModification3DEWBIK::setup_modification(SkeletonModificationStack3D *p_stack) {
+	stack = p_stack;
+	if (!stack) {
+		return;
+	}
+	skeleton = stack->skeleton;
+	if (!skeleton) {
+		return;
+	}
+
+	// Without a root bone every root of the skeleton is solved.
+	if (!root_bone.is_empty() && root_bone_index == -1) {
+		set_root_bone(root_bone);
+	}
+	ERR_FAIL_COND_MSG(get_solved_roots().is_empty(), "EWBIK skeleton has no root bone to solve from.");
+
+	is_dirty = true;
+	is_setup = true;
+	calc_done = false;
+	call_deferred("update_skeleton");
+
+	execution_error_found = false;
+}
+
+void SkeletonModification3DEWBIK::solve(real_t p_blending_delta) {
+	if (p_blending_delta <= 0.01f) {
+		return; // Skip solving
+	}
+	finish_async_solve();
+
+	bool gathered = gather_solve(p_blending_delta);
+	if (gathered) {
+		solve_gathered();
+	}
+	scatter_solve(gathered);
+}
+
+bool SkeletonModification3DEWBIK::gather_solve(real_t p_blending_delta) {
+	blend_strength = p_blending_delta;
+	if (!effector_count || segmented_skeletons.is_empty()) {
+		return false;
+	}
+	// Reset the local bone overrides, so the snapshot holds the animated input pose.
+	for (int32_t bone_i = 0; bone_i < bone_list.size(); bone_i++) {
+		skeleton->set_bone_local_pose_override(bone_list[bone_i]->get_bone_id(),
+			Transform(), 0.0, false);
+	}
+	input_pose.resize(bone_list.size());
+	for (int32_t bone_i = 0; bone_i < bone_list.size(); bone_i++) {
+		input_pose.write[bone_i] = skeleton->get_bone_global_pose(bone_list[bone_i]->get_bone_id());
+	}
+	// Targets and effector settings are copied here, the solve only reads the copies.
+	for (int32_t effector_i = 0; effector_i < multi_effector.size(); effector_i++) {
+		if (multi_effector[effector_i]->get_effector()->gather_target(skeleton)) {
+			weights_dirty = true;
+		}
+	}
+	return true;
+}
+
+void SkeletonModification3DEWBIK::solve_gathered() {
+	// Takes the gathered snapshot to solved_rotations without touching the skeleton or the scene,
+	// so rigs can be solved on worker threads between gather and scatter.
+	begin_solve();
+	iterated_improved_solver();
+	update_solved_rotations();
+}
+
+void SkeletonModification3DEWBIK::solve_gathered_lanes(SkeletonModification3DEWBIK *const *p_rigs, int32_t p_count) {
+	ERR_FAIL_COND(p_count < 1 || p_count > QCPLanes::LANES);
+	SkeletonModification3DEWBIK *lead = p_rigs[0];
+	bool packable = true;
+	for (int32_t lane = 0; lane < p_count; lane++) {
+		SkeletonModification3DEWBIK *rig = p_rigs[lane];
+		packable = packable && rig->is_crowd_packable() && rig->crowd_signature == lead->crowd_signature &&
+				rig->bone_list.size() == lead->bone_list.size() && rig->segmented_skeletons.size() == lead->segmented_skeletons.size();
+		// The signature can collide, the lanes index every chain by the layout of the lead.
+		for (int32_t root_i = 0; packable && root_i < rig->segmented_skeletons.size(); root_i++) {
+			packable = rig->segmented_skeletons[root_i]->is_layout_equal(lead->segmented_skeletons[root_i].ptr());
+		}
+	}
+	if (!packable) {
+		ERR_PRINT("EWBIK crowd pack holds rigs that can't share a solve plan, solving them one by one.");
+		for (int32_t lane = 0; lane < p_count; lane++) {
+			p_rigs[lane]->solve_gathered();
+		}
+		return;
+	}
+
+	// Same loop as iterated_improved_solver, run in lockstep. A lane drops out of the mask once its
+	// own rig would have stopped iterating, and keeps the pose it reached.
+	uint64_t start_usec = OS::get_singleton()->get_ticks_usec();
+	uint32_t mask = 0;
+	IterationState states[QCPLanes::LANES];
+	real_t relaxation[QCPLanes::LANES] = {};
+	for (int32_t lane = 0; lane < p_count; lane++) {
+		p_rigs[lane]->begin_solve();
+		p_rigs[lane]->begin_iterations(states[lane], start_usec);
+		mask |= 1 << lane;
+	}
+	IKBoneChain *chains[QCPLanes::LANES] = {};
+	while (mask) {
+		for (int32_t lane = 0; lane < p_count; lane++) {
+			if ((mask & (1 << lane)) && !p_rigs[lane]->next_iteration(states[lane])) {
+				mask &= ~(1 << lane);
+			}
+			relaxation[lane] = states[lane].relaxation;
+		}
+		for (int32_t root_i = 0; root_i < lead->segmented_skeletons.size(); root_i++) {
+			for (int32_t lane = 0; lane < p_count; lane++) {
+				chains[lane] = p_rigs[lane]->segmented_skeletons[root_i].ptr();
+			}
+			IKBoneChain::grouped_segment_solver_lanes(chains, mask, relaxation);
+		}
+		for (int32_t lane = 0; lane < p_count; lane++) {
+			if (mask & (1 << lane)) {
+				p_rigs[lane]->last_iteration_count++;
+			}
+		}
+	}
+	for (int32_t lane = 0; lane < p_count; lane++) {
+		p_rigs[lane]->end_iterations(states[lane]);
+		p_rigs[lane]->update_solved_rotations();
+	}
+}
+
+void SkeletonModification3DEWBIK::begin_solve() {
+	update_effector_weights();
+	update_shadow_bones_transform();
+	for (int32_t root_i = 0; root_i < segmented_skeletons.size(); root_i++) {
+		segmented_skeletons[root_i]->solve_unreachable();
+	}
+	if (iterations_per_frame > 0 && (pending_iterations == 0 || input_motion > warm_start_reset_distance)) {
+		// Targets that keep moving carry the remaining count over, so the solve still completes.
+		// Only a jump that also resets the warm start begins a new count.
+		pending_iterations = get_scaled_iterations();
+	}
+}
+
+void SkeletonModification3DEWBIK::scatter_solve(bool p_gathered) {
+	if (p_gathered) {
+		scatter_rotations(solved_rotations, blend_strength);
+	}
+	complete_solve(p_gathered);
+}
+
+void SkeletonModification3DEWBIK::complete_solve(bool p_solved) {
+	if (p_solved) {
+		if (pending_iterations == 0) {
+			for (int32_t root_i = 0; root_i < segmented_skeletons.size(); root_i++) {
+				segmented_skeletons[root_i]->mark_solved();
+			}
+		}
+		has_solution = true;
+	}
+
+	// Held effectors that changed still need a solve on one of the coming frames.
+	calc_done = pending_iterations == 0 && !has_deferred_effectors;
+}
+
+void SkeletonModification3DEWBIK::_async_solve(void *p_self, uint32_t p_index) {
+	((SkeletonModification3DEWBIK *)p_self)->solve_gathered();
+}
+
+void SkeletonModification3DEWBIK::finish_async_solve() {
+	if (!async_pending) {
+		return;
+	}
+	IKTaskScheduler::wait(async_task);
+	async_pending = false;
+	SWAP(front_rotations, solved_rotations);
+	front_strength = blend_strength;
+	complete_solve(true);
+}
+
+void SkeletonModification3DEWBIK::scatter_rotations(const Vector<Quat> &p_rotations, real_t p_blending_delta) {
+	// A buffer from before a rebuild no longer lines up with the bones.
+	if (p_rotations.size() != bone_list.size()) {
+		return;
+	}
+	for (int32_t bone_i = 0; bone_i < bone_list.size(); bone_i++) {
+		bone_list[bone_i]->set_skeleton_bone_transform(skeleton, p_rotations[bone_i], p_blending_delta);
+	}
 }
 
-Transform SkeletonModification3DEWBIK::get_effector_target_transform(int32_t p_index) const {
-	return multi_effector[p_index]->get_effector()->get_target_transform();
+int32_t SkeletonModification3DEWBIK::get_scaled_iterations() const {
+	return MAX(1, int32_t(Math::round(ik_iterations * lod_factor * get_strength_factor())));
 }
 
-void SkeletonModification3DEWBIK::set_effector_use_node_rotation(int32_t p_index, bool p_use_node_rot) {
-	multi_effector.write[p_index]->get_effector()->set_use_target_node_rotation(p_use_node_rot);
-	calc_done = false;
+int32_t SkeletonModification3DEWBIK::get_scaled_coarse_iterations() const {
+	// Unlike the regular iterations, a low detail or faded solve may skip the coarse ones altogether.
+	return int32_t(Math::round(coarse_iterations * lod_factor * get_strength_factor()));
 }
 
-bool SkeletonModification3DEWBIK::get_effector_use_node_rotation(int32_t p_index) const {
-	return multi_effector[p_index]->get_effector()->get_use_target_node_rotation();
+real_t SkeletonModification3DEWBIK::get_scaled_tolerance() const {
+	// The override blends the error down by the same strength, so a faded solve can stop that much earlier.
+	return convergence_tolerance / get_strength_factor();
 }
 
-Vector<Ref<IKBone3D>> SkeletonModification3DEWBIK::get_bone_effectors() const {
-	return multi_effector;
+real_t SkeletonModification3DEWBIK::get_strength_factor() const {
+	return scale_iterations_by_strength ? CLAMP(blend_strength, 0.01, 1.0) : 1.0;
 }
 
-int32_t SkeletonModification3DEWBIK::find_effector(const String &p_name) const {
-	BoneId bone = skeleton->find_bone(p_name);
-	for (int32_t effector_i = 0; effector_i < multi_effector.size(); effector_i++) {
-		if (multi_effector[effector_i].is_valid() && multi_effector[effector_i]->get_bone_id() == bone) {
-			return effector_i;
+void SkeletonModification3DEWBIK::iterated_improved_solver() {
+	IterationState state;
+	begin_iterations(state, OS::get_singleton()->get_ticks_usec());
+	int32_t passes = lod_factor < 0.5 ? 0 : stabilization_passes;
+	// Cold solves of long chains first settle at reduced resolution, the regular iterations then refine them.
+	if (coarse_segment_bones > 1 && !warm_started) {
+		// Counted apart from the regular iterations, a coarse one only rotates a fraction of the bones.
+		while (next_coarse_iteration(state)) {
+			grouped_root_solver(0, 1.0, coarse_segment_bones);
+			last_coarse_iteration_count++;
+		}
+		if (iterations_per_frame > 0) {
+			// They still take their share of an amortized frame.
+			state.iterations = MAX(state.iterations - last_coarse_iteration_count, 0);
 		}
 	}
-	return -1;
+	while (next_iteration(state)) {
+		grouped_root_solver(passes, state.relaxation, 1);
+		last_iteration_count++;
+	}
+	end_iterations(state);
 }
 
-void SkeletonModification3DEWBIK::remove_effector(int32_t p_index) {
-	ERR_FAIL_INDEX(p_index, multi_effector.size());
-	multi_effector.remove(p_index);
-	effector_count--;
-
-	is_dirty = true;
+void SkeletonModification3DEWBIK::begin_iterations(IterationState &r_state, uint64_t p_start_usec) {
+	r_state.start_usec = p_start_usec;
+	r_state.budget_usec = uint64_t(time_budget_millisecond * lod_factor * get_strength_factor() * 1000.0);
+	r_state.iterations = iterations_per_frame > 0 ? MIN(iterations_per_frame, pending_iterations) : get_scaled_iterations();
+	r_state.relaxation = over_relaxation;
+	r_state.prev_error = MAXFLOAT;
+	r_state.done = false;
+	last_iteration_count = 0;
+	last_coarse_iteration_count = 0;
 }
 
-void SkeletonModification3DEWBIK::execute(float delta) {
-	ERR_FAIL_COND_MSG(!stack || !is_setup || skeleton == nullptr,
-			"Modification is not setup and therefore cannot execute!");
-	if (!enabled)
-		return;
-
-	if (is_dirty) {
-		update_skeleton();
+bool SkeletonModification3DEWBIK::next_iteration(IterationState &r_state) {
+	// Every pass leaves the shadow skeleton in a valid pose, so the solve can stop after any iteration.
+	// With a time budget the iteration count is no longer the limit, unless the solve is amortized.
+	real_t error = 0.0;
+	r_state.done = schedule_effectors(error);
+	if (r_state.done) {
+		return false;
 	}
-	if (!is_calc_done()) {
-		solve(stack->get_strength());
+	if (last_iteration_count >= r_state.iterations && (!r_state.budget_usec || iterations_per_frame > 0)) {
+		return false;
 	}
-	execution_error_found = false;
-}
-
-void SkeletonModification3DEWBIK::setup_modification(SkeletonModificationStack3D *p_stack) {
-	stack = p_stack;
-	if (!stack) {
-		return;
+	if (last_iteration_count && is_over_budget(r_state)) {
+		return false;
 	}
-	skeleton = stack->skeleton;
-	if (!skeleton) {
-		return;
+	// Over-relaxation backs off towards plain QCP steps whenever an iteration raised the error,
+	// and recovers gradually while the error keeps dropping.
+	if (error > r_state.prev_error) {
+		r_state.relaxation = 1.0 + (r_state.relaxation - 1.0) * 0.5;
+	} else {
+		r_state.relaxation = MIN(over_relaxation, r_state.relaxation + (over_relaxation - 1.0) * 0.25);
 	}
+	r_state.prev_error = error;
+	return true;
+}
 
-	if (root_bone.is_empty()) {
-	 	Vector<int32_t> roots;
-		for (int32_t bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
-			int32_t parent = skeleton->get_bone_parent(bone_i);
-			if (parent == -1) {
-				roots.push_back(bone_i);
-			}
-		}
-		if (roots.size()) {
-			set_root_bone_index(roots[0]);
-		}
-	} else if (root_bone_index == -1) {
-		set_root_bone(root_bone);
+bool SkeletonModification3DEWBIK::next_coarse_iteration(IterationState &r_state) {
+	// Same stops as next_iteration, on the scaled coarse count and without the relaxation.
+	real_t error = 0.0;
+	r_state.done = schedule_effectors(error);
+	if (r_state.done || last_coarse_iteration_count >= get_scaled_coarse_iterations()) {
+		return false;
 	}
-	ERR_FAIL_COND(root_bone.is_empty());
-
-	is_dirty = true;
-	is_setup = true;
-	calc_done = false;
-	call_deferred("update_skeleton");
+	if (iterations_per_frame > 0 && last_coarse_iteration_count >= r_state.iterations) {
+		return false;
+	}
+	return !is_over_budget(r_state);
+}
 
-	execution_error_found = false;
+bool SkeletonModification3DEWBIK::is_over_budget(const IterationState &p_state) const {
+	return p_state.budget_usec && OS::get_singleton()->get_ticks_usec() - p_state.start_usec >= p_state.budget_usec;
 }
 
-void SkeletonModification3DEWBIK::solve(real_t p_blending_delta) {
-	if (p_blending_delta <= 0.01f) {
-		return; // Skip solving
+void SkeletonModification3DEWBIK::end_iterations(const IterationState &r_state) {
+	budget_used_millisecond = (OS::get_singleton()->get_ticks_usec() - r_state.start_usec) / 1000.0;
+	if (iterations_per_frame > 0) {
+		pending_iterations = r_state.done ? 0 : MAX(pending_iterations - last_iteration_count, 0);
 	}
+}
 
-	if (effector_count && segmented_skeleton.is_valid() && segmented_skeleton->get_effector_direct_descendents_size() > 0) {
-		update_shadow_bones_transform();
-		iterated_improved_solver();
-		update_skeleton_bones_transform(p_blending_delta);
+void SkeletonModification3DEWBIK::grouped_root_solver(int32_t p_stabilization_passes, real_t p_relaxation, int32_t p_coarse_bones) {
+	IKTaskScheduler *scheduler = IKTaskScheduler::get_singleton();
+	if (parallel_solve && scheduler && segmented_skeletons.size() > 1) {
+		// Roots share no bones, so each one is a task of its own, spawning tasks for its subtrees.
+		RootWork work;
+		work.modification = this;
+		work.stabilization_passes = p_stabilization_passes;
+		work.relaxation = p_relaxation;
+		work.coarse_bones = p_coarse_bones;
+		scheduler->run(&SkeletonModification3DEWBIK::_solve_root, &work, segmented_skeletons.size());
+		return;
+	}
+	for (int32_t root_i = 0; root_i < segmented_skeletons.size(); root_i++) {
+		segmented_skeletons[root_i]->grouped_segment_solver(p_stabilization_passes, p_relaxation, p_coarse_bones, parallel_solve);
 	}
+}
 
-	calc_done = true;
+void SkeletonModification3DEWBIK::_solve_root(void *p_work, uint32_t p_index) {
+	RootWork *work = (RootWork *)p_work;
+	work->modification->segmented_skeletons[p_index]->grouped_segment_solver(work->stabilization_passes, work->relaxation, work->coarse_bones, true);
 }
 
-void SkeletonModification3DEWBIK::iterated_improved_solver() {
-	for (int i = 0; i < ik_iterations; i++) {
-		segmented_skeleton->grouped_segment_solver(stabilization_passes);
+bool SkeletonModification3DEWBIK::schedule_effectors(real_t &r_total_error) {
+	real_t error_sum = 0.0;
+	int32_t pending = 0;
+	r_total_error = 0.0;
+	targets_reachable = true;
+	for (int32_t effector_i = 0; effector_i < multi_effector.size(); effector_i++) {
+		Ref<IKEffector3D> effector = multi_effector[effector_i]->get_effector();
+		if (effector.is_null()) {
+			continue;
+		}
+		real_t error = effector->update_error();
+		r_total_error += error;
+		// Straightened chains have nothing left to iterate, but their targets aren't reached either.
+		if (effector->is_unreachable()) {
+			targets_reachable = false;
+		}
+		// A zero budget skips the effector, so it doesn't count towards the mean either.
+		if (effector->is_pending(get_scaled_tolerance(), lod_factor)) {
+			error_sum += error;
+			pending++;
+		}
+	}
+	// Returns true once nothing is left to iterate, but only reached targets count as converged.
+	converged = !pending && targets_reachable;
+	if (!pending) {
+		return true;
+	}
+
+	real_t mean_error = error_sum / pending;
+	for (int32_t effector_i = 0; effector_i < multi_effector.size(); effector_i++) {
+		Ref<IKEffector3D> effector = multi_effector[effector_i]->get_effector();
+		if (effector.is_valid()) {
+			effector->schedule_passes(mean_error, get_scaled_tolerance(), lod_factor);
+		}
 	}
+	return false;
 }
 
 void SkeletonModification3DEWBIK::update_skeleton() {
 	if (!is_dirty)
 		return;
 
+	finish_async_solve();
+	front_rotations.clear();
 	if (effector_count) {
 		update_segments();
 	} else {
 		generate_default_effectors();
 	}
-	segmented_skeleton->update_effector_list();
+	// Frozen and twist bones must be known before the chains compile their solve lists.
+	for (int32_t bone_i = 0; bone_i < bone_list.size(); bone_i++) {
+		Ref<IKBone3D> bone = bone_list[bone_i];
+		bone->set_frozen(frozen_bones.has(skeleton->get_bone_name(bone->get_bone_id())));
+		bone->set_twist_driver(Ref<IKBone3D>(), 0.0);
+	}
+	update_twist_bones();
+	for (int32_t root_i = 0; root_i < segmented_skeletons.size(); root_i++) {
+		segmented_skeletons[root_i]->update_effector_list(effector_weight_threshold);
+		segmented_skeletons[root_i]->update_solver_backend(solver_backend);
+	}
 	notify_property_list_changed();
 
+	update_crowd_signature();
+
 	is_dirty = false;
 	calc_done = false;
+	has_solution = false;
+	weights_dirty = true;
 
-	// segmented_skeleton->debug_print_chains();
+	// segmented_skeletons[0]->debug_print_chains();
 }
 
 void SkeletonModification3DEWBIK::generate_default_effectors() {
-	segmented_skeleton = Ref<IKBoneChain>(memnew(IKBoneChain(skeleton, root_bone_index)));
-	segmented_skeleton->generate_default_segments_from_root();
-	Vector<Ref<IKBoneChain>> effector_chains = segmented_skeleton->get_effector_direct_descendents();
+	segmented_skeletons.clear();
+	Vector<Ref<IKBoneChain>> effector_chains;
+	Vector<BoneId> roots = get_solved_roots();
+	for (int32_t root_i = 0; root_i < roots.size(); root_i++) {
+		Ref<IKBoneChain> chain = Ref<IKBoneChain>(memnew(IKBoneChain(skeleton, roots[root_i])));
+		chain->generate_default_segments_from_root();
+		effector_chains.append_array(chain->get_effector_direct_descendents());
+		segmented_skeletons.push_back(chain);
+	}
 	effector_count = effector_chains.size();
 	multi_effector.resize(effector_count);
 	for (int32_t chain_i = 0; chain_i < effector_count; chain_i++) {
@@ -283,40 +1206,148 @@ void SkeletonModification3DEWBIK::generate_default_effectors() {
 	update_bone_list();
 }
 
-void SkeletonModification3DEWBIK::update_shadow_bones_transform() {
-	// Reset the local bone overrides
-	for (int32_t bone_i = 0; bone_i < bone_list.size(); bone_i++) {
-		skeleton->set_bone_local_pose_override(bone_list[bone_i]->get_bone_id(),
-			Transform(), 0.0, false);
+void SkeletonModification3DEWBIK::update_effector_weights() {
+	for (int32_t effector_i = 0; effector_i < multi_effector.size(); effector_i++) {
+		weights_dirty = multi_effector[effector_i]->get_effector()->update_active(lod_factor) || weights_dirty;
+	}
+	if (!weights_dirty) {
+		return;
+	}
+	for (int32_t root_i = 0; root_i < segmented_skeletons.size(); root_i++) {
+		segmented_skeletons[root_i]->update_heading_weights();
 	}
+	weights_dirty = false;
+	// Chains that gained or lost headings can't keep their cached rotations.
+	has_solution = false;
+}
 
+void SkeletonModification3DEWBIK::update_shadow_bones_transform() {
 	for (int32_t bone_i = 0; bone_i < bone_list.size(); bone_i++) {
 		Ref<IKBone3D> bone = bone_list[bone_i];
-		bone->set_initial_transform(skeleton);
+		bone->set_initial_transform(input_pose[bone_i]);
+	}
+
+	// Teleports and animation cuts make the previous solution a bad guess, so those frames start cold.
+	// An amortized solve always carries its partial state over until it is done.
+	bool amortizing = iterations_per_frame > 0 && pending_iterations > 0;
+	warm_started = (warm_start || amortizing) && has_solution;
+	input_motion = 0.0;
+	for (int32_t effector_i = 0; effector_i < multi_effector.size(); effector_i++) {
+		real_t motion = multi_effector[effector_i]->get_effector()->update_input_motion();
+		input_motion = MAX(input_motion, motion);
+		if (motion > warm_start_reset_distance) {
+			warm_started = false;
+		}
+	}
+
+	// Slow effectors take turns, staggered by index so they don't all come due on the same frame.
+	for (int32_t effector_i = 0; effector_i < multi_effector.size(); effector_i++) {
+		multi_effector[effector_i]->get_effector()->update_held(has_solution, solve_frame + effector_i);
+	}
+	solve_frame++;
+
+	// Only chains whose goals or input poses moved beyond the epsilons are solved again.
+	for (int32_t root_i = 0; root_i < segmented_skeletons.size(); root_i++) {
+		segmented_skeletons[root_i]->update_dirty(dirty_position_epsilon, dirty_angle_epsilon, !has_solution);
+		segmented_skeletons[root_i]->propagate_dirty();
+	}
+	has_deferred_effectors = false;
+	for (int32_t effector_i = 0; effector_i < multi_effector.size(); effector_i++) {
+		has_deferred_effectors = has_deferred_effectors || multi_effector[effector_i]->get_effector()->is_deferred();
+	}
+	for (int32_t root_i = 0; root_i < segmented_skeletons.size(); root_i++) {
+		segmented_skeletons[root_i]->seed_rotations(warm_started ? (amortizing ? 1.0 : warm_start_blend) : 0.0);
 	}
 }
 
-void SkeletonModification3DEWBIK::update_skeleton_bones_transform(real_t p_blending_delta) {
+void SkeletonModification3DEWBIK::update_solved_rotations() {
+	// Twist bones take their share of the driver's roll only once the driver is solved.
+	for (int32_t twist_i = 0; twist_i < twist_bone_list.size(); twist_i++) {
+		twist_bone_list.write[twist_i]->update_twist();
+	}
+	solved_rotations.resize(bone_list.size());
 	for (int32_t bone_i = 0; bone_i < bone_list.size(); bone_i++) {
-		Ref<IKBone3D> bone = bone_list[bone_i];
-		bone->set_skeleton_bone_transform(skeleton, p_blending_delta);
+		solved_rotations.write[bone_i] = bone_list[bone_i]->get_solved_rotation();
 	}
 }
 
 void SkeletonModification3DEWBIK::update_segments() {
 	if (effector_count) {
 		update_effectors_map();
-		segmented_skeleton = Ref<IKBoneChain>(memnew(IKBoneChain(skeleton, root_bone_index, effectors_map)));
+		segmented_skeletons.clear();
+		Vector<BoneId> roots = get_solved_roots();
+		for (int32_t root_i = 0; root_i < roots.size(); root_i++) {
+			Ref<IKBoneChain> chain = Ref<IKBoneChain>(memnew(IKBoneChain(skeleton, roots[root_i], effectors_map)));
+			// Roots without effectors below them keep their input pose.
+			if (chain->get_effector_direct_descendents_size() > 0) {
+				segmented_skeletons.push_back(chain);
+			}
+		}
 		update_bone_list();
 	}
 }
 
+Vector<BoneId> SkeletonModification3DEWBIK::get_solved_roots() const {
+	Vector<BoneId> roots;
+	if (root_bone_index != -1) {
+		roots.push_back(root_bone_index);
+		return roots;
+	}
+	ERR_FAIL_COND_V(!skeleton, roots);
+	for (BoneId bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
+		if (skeleton->get_bone_parent(bone_i) == -1) {
+			roots.push_back(bone_i);
+		}
+	}
+	return roots;
+}
+
+Ref<IKBoneChain> SkeletonModification3DEWBIK::find_segment_containing(const Ref<IKBone3D> &p_bone) const {
+	for (int32_t root_i = 0; root_i < segmented_skeletons.size(); root_i++) {
+		Ref<IKBoneChain> chain = segmented_skeletons[root_i]->get_child_segment_containing(p_bone);
+		if (chain.is_valid()) {
+			return chain;
+		}
+	}
+	return Ref<IKBoneChain>();
+}
+
 void SkeletonModification3DEWBIK::update_bone_list() {
 	bone_list.clear();
-	segmented_skeleton->get_bone_list(bone_list);
+	for (int32_t root_i = segmented_skeletons.size() - 1; root_i >= 0; root_i--) {
+		segmented_skeletons[root_i]->get_bone_list(bone_list);
+	}
 	bone_list.reverse();
 }
 
+void SkeletonModification3DEWBIK::update_twist_bones() {
+	twist_bone_list.clear();
+	for (int32_t twist_i = 0; twist_i < twist_bones.size(); twist_i++) {
+		const TwistBone &twist = twist_bones[twist_i];
+		BoneId bone_id = skeleton->find_bone(twist.name);
+		ERR_CONTINUE_MSG(bone_id == -1, "EWBIK twist bone " + twist.name + " doesn't exist in the skeleton.");
+		Ref<IKBone3D> driver = find_shadow_bone(skeleton->find_bone(twist.driver));
+		ERR_CONTINUE_MSG(driver.is_null(), "EWBIK twist driver " + twist.driver + " must be a bone solved by the modification.");
+		Ref<IKBone3D> bone = find_shadow_bone(bone_id);
+		if (bone.is_null()) {
+			// Roll bones beside the chains only need a rotation to write back, so they stand alone.
+			bone = Ref<IKBone3D>(memnew(IKBone3D(bone_id)));
+			bone_list.push_back(bone);
+		}
+		bone->set_twist_driver(driver, twist.fraction);
+		twist_bone_list.push_back(bone);
+	}
+}
+
+Ref<IKBone3D> SkeletonModification3DEWBIK::find_shadow_bone(BoneId p_bone) const {
+	for (int32_t bone_i = 0; bone_i < bone_list.size(); bone_i++) {
+		if (bone_list[bone_i]->get_bone_id() == p_bone) {
+			return bone_list[bone_i];
+		}
+	}
+	return nullptr;
+}
+
 void SkeletonModification3DEWBIK::update_effectors_map() {
 	effectors_map.clear();
 	for (int32_t index = 0; index < effector_count; index++) {
@@ -325,8 +1356,61 @@ void SkeletonModification3DEWBIK::update_effectors_map() {
 	}
 }
 
+void SkeletonModification3DEWBIK::update_crowd_signature() {
+	// Covers the shape of the chain trees. Weights, targets and poses differ freely between lanes.
+	uint32_t hash = hash_djb2_one_32(segmented_skeletons.size());
+	hash = hash_djb2_one_float(effector_weight_threshold, hash);
+	for (int32_t bone_i = 0; bone_i < bone_list.size(); bone_i++) {
+		hash = hash_djb2_one_32(bone_list[bone_i]->get_bone_id(), hash);
+		// Twist bones and orientation locks drop out of the solve lists just like frozen ones.
+		hash = hash_djb2_one_32(bone_list[bone_i]->is_rigid(), hash);
+	}
+	for (int32_t root_i = 0; root_i < segmented_skeletons.size(); root_i++) {
+		hash = segmented_skeletons[root_i]->hash_layout(hash);
+	}
+	for (int32_t effector_i = 0; effector_i < multi_effector.size(); effector_i++) {
+		if (multi_effector[effector_i].is_valid()) {
+			hash = hash_djb2_one_32(multi_effector[effector_i]->get_bone_id(), hash);
+		}
+	}
+	crowd_signature = hash;
+}
+
+void SkeletonModification3DEWBIK::get_input_snapshot(Vector<Transform> &r_snapshot) const {
+	// Covers everything a goal or an initial transform is computed from, apart from target nodes.
+	r_snapshot.clear();
+	if (skeleton->is_inside_tree()) {
+		r_snapshot.push_back(skeleton->get_global_transform());
+	}
+	// Ancestors of the solved roots move the whole rig without changing any of its own poses.
+	for (int32_t root_i = 0; root_i < segmented_skeletons.size(); root_i++) {
+		BoneId parent = skeleton->get_bone_parent(segmented_skeletons[root_i]->get_root()->get_bone_id());
+		if (parent != -1) {
+			r_snapshot.push_back(skeleton->get_bone_global_pose(parent));
+		}
+	}
+	for (int32_t bone_i = 0; bone_i < bone_list.size(); bone_i++) {
+		r_snapshot.push_back(skeleton->get_bone_pose(bone_list[bone_i]->get_bone_id()));
+	}
+	for (int32_t effector_i = 0; effector_i < multi_effector.size(); effector_i++) {
+		Ref<IKEffector3D> effector = multi_effector[effector_i]->get_effector();
+		if (effector.is_valid()) {
+			r_snapshot.push_back(effector->get_target_transform());
+		}
+	}
+}
+
 bool SkeletonModification3DEWBIK::is_calc_done() {
-	if (!calc_done) {
+	Vector<Transform> snapshot;
+	get_input_snapshot(snapshot);
+	bool input_changed = stack->get_strength() != input_strength || snapshot.size() != input_snapshot.size();
+	for (int32_t input_i = 0; !input_changed && input_i < snapshot.size(); input_i++) {
+		input_changed = !snapshot[input_i].is_equal_approx(input_snapshot[input_i]);
+	}
+	input_snapshot = snapshot;
+	input_strength = stack->get_strength();
+	if (!calc_done || input_changed) {
+		calc_done = false;
 		return false;
 	}
 
@@ -363,6 +1447,36 @@ void SkeletonModification3DEWBIK::_validate_property(PropertyInfo &property) con
 
 void SkeletonModification3DEWBIK::_get_property_list(List<PropertyInfo> *p_list) const {
 	p_list->push_back(PropertyInfo(Variant::INT, "ik_iterations", PROPERTY_HINT_RANGE, "0,65535,1"));
+	p_list->push_back(PropertyInfo(Variant::INT, "stabilization_passes", PROPERTY_HINT_RANGE, "0,8,1"));
+	p_list->push_back(PropertyInfo(Variant::INT, "iterations_per_frame", PROPERTY_HINT_RANGE, "0,65535,1"));
+	p_list->push_back(PropertyInfo(Variant::FLOAT, "over_relaxation", PROPERTY_HINT_RANGE, "1,1.95,0.01"));
+	p_list->push_back(PropertyInfo(Variant::INT, "solver_backend", PROPERTY_HINT_ENUM, "QCP,CCD,FABRIK"));
+	p_list->push_back(PropertyInfo(Variant::BOOL, "parallel_solve"));
+	p_list->push_back(PropertyInfo(Variant::BOOL, "server_solve"));
+	p_list->push_back(PropertyInfo(Variant::BOOL, "async_solve"));
+	p_list->push_back(PropertyInfo(Variant::BOOL, "crowd_solve"));
+	p_list->push_back(PropertyInfo(Variant::INT, "coarse/segment_bones", PROPERTY_HINT_RANGE, "0,32,1,or_greater"));
+	p_list->push_back(PropertyInfo(Variant::INT, "coarse/iterations", PROPERTY_HINT_RANGE, "0,64,1,or_greater"));
+	p_list->push_back(PropertyInfo(Variant::BOOL, "warm_start"));
+	p_list->push_back(PropertyInfo(Variant::FLOAT, "warm_start_blend", PROPERTY_HINT_RANGE, "0,1,0.01"));
+	p_list->push_back(PropertyInfo(Variant::FLOAT, "warm_start_reset_distance", PROPERTY_HINT_RANGE, "0,10,0.01,or_greater"));
+	p_list->push_back(PropertyInfo(Variant::FLOAT, "dirty_position_epsilon", PROPERTY_HINT_RANGE, "0,1,0.0001,or_greater"));
+	p_list->push_back(PropertyInfo(Variant::FLOAT, "dirty_angle_epsilon", PROPERTY_HINT_RANGE, "0,0.5,0.0001,or_greater"));
+	p_list->push_back(PropertyInfo(Variant::FLOAT, "lod/importance", PROPERTY_HINT_RANGE, "0,1,0.01"));
+	p_list->push_back(PropertyInfo(Variant::FLOAT, "lod/distance_near", PROPERTY_HINT_RANGE, "0,100,0.1,or_greater"));
+	p_list->push_back(PropertyInfo(Variant::FLOAT, "lod/distance_far", PROPERTY_HINT_RANGE, "0,500,0.1,or_greater"));
+	p_list->push_back(PropertyInfo(Variant::FLOAT, "lod/bounds_radius", PROPERTY_HINT_RANGE, "0,10,0.01,or_greater"));
+	p_list->push_back(PropertyInfo(Variant::INT, "lod/max_frame_skip", PROPERTY_HINT_RANGE, "0,16,1"));
+	p_list->push_back(PropertyInfo(Variant::FLOAT, "time_budget_millisecond", PROPERTY_HINT_RANGE, "0,100,0.01,or_greater"));
+	p_list->push_back(PropertyInfo(Variant::FLOAT, "convergence_tolerance", PROPERTY_HINT_RANGE, "0,1,0.0001,or_greater"));
+	p_list->push_back(PropertyInfo(Variant::BOOL, "scale_iterations_by_strength"));
+	p_list->push_back(PropertyInfo(Variant::INT, "twist_bone_count", PROPERTY_HINT_RANGE, "0,65535,1"));
+	for (int i = 0; i < twist_bones.size(); i++) {
+		p_list->push_back(PropertyInfo(Variant::STRING, "twist_bones/" + itos(i) + "/name"));
+		p_list->push_back(PropertyInfo(Variant::STRING, "twist_bones/" + itos(i) + "/driver"));
+		p_list->push_back(PropertyInfo(Variant::FLOAT, "twist_bones/" + itos(i) + "/fraction", PROPERTY_HINT_RANGE, "0,1,0.01"));
+	}
+	p_list->push_back(PropertyInfo(Variant::FLOAT, "effector_weight_threshold", PROPERTY_HINT_RANGE, "0,1,0.001"));
 	p_list->push_back(PropertyInfo(Variant::INT, "effector_count", PROPERTY_HINT_RANGE, "0,65535,1"));
 	for (int i = 0; i < effector_count; i++) {
 		p_list->push_back(PropertyInfo(Variant::STRING, "effectors/" + itos(i) + "/name"));
@@ -373,6 +1487,20 @@ void SkeletonModification3DEWBIK::_get_property_list(List<PropertyInfo> *p_list)
 				PropertyInfo(Variant::BOOL, "effectors/" + itos(i) + "/use_node_rotation"));
 		p_list->push_back(
 				PropertyInfo(Variant::TRANSFORM, "effectors/" + itos(i) + "/target_transform"));
+		p_list->push_back(
+				PropertyInfo(Variant::BOOL, "effectors/" + itos(i) + "/enabled"));
+		p_list->push_back(
+				PropertyInfo(Variant::FLOAT, "effectors/" + itos(i) + "/weight", PROPERTY_HINT_RANGE, "0,1,0.01,or_greater"));
+		p_list->push_back(
+				PropertyInfo(Variant::INT, "effectors/" + itos(i) + "/solver_backend", PROPERTY_HINT_ENUM, "Inherit,QCP,CCD,FABRIK"));
+		p_list->push_back(
+				PropertyInfo(Variant::FLOAT, "effectors/" + itos(i) + "/depth_falloff", PROPERTY_HINT_RANGE, "0,1,0.01"));
+		p_list->push_back(
+				PropertyInfo(Variant::FLOAT, "effectors/" + itos(i) + "/budget", PROPERTY_HINT_RANGE, "0,4,0.01,or_greater"));
+		p_list->push_back(
+				PropertyInfo(Variant::FLOAT, "effectors/" + itos(i) + "/lod_threshold", PROPERTY_HINT_RANGE, "0,1,0.01"));
+		p_list->push_back(
+				PropertyInfo(Variant::INT, "effectors/" + itos(i) + "/update_divider", PROPERTY_HINT_RANGE, "1,16,1,or_greater"));
 	}
 }
 
@@ -381,6 +1509,95 @@ bool SkeletonModification3DEWBIK::_get(const StringName &p_name, Variant &r_ret)
 	if (name == "ik_iterations") {
 		r_ret = get_ik_iterations();
 		return true;
+	} else if (name == "stabilization_passes") {
+		r_ret = get_stabilization_passes();
+		return true;
+	} else if (name == "iterations_per_frame") {
+		r_ret = get_iterations_per_frame();
+		return true;
+	} else if (name == "over_relaxation") {
+		r_ret = get_over_relaxation();
+		return true;
+	} else if (name == "solver_backend") {
+		r_ret = get_solver_backend();
+		return true;
+	} else if (name == "parallel_solve") {
+		r_ret = get_parallel_solve();
+		return true;
+	} else if (name == "server_solve") {
+		r_ret = get_server_solve();
+		return true;
+	} else if (name == "async_solve") {
+		r_ret = get_async_solve();
+		return true;
+	} else if (name == "crowd_solve") {
+		r_ret = get_crowd_solve();
+		return true;
+	} else if (name == "coarse/segment_bones") {
+		r_ret = get_coarse_segment_bones();
+		return true;
+	} else if (name == "coarse/iterations") {
+		r_ret = get_coarse_iterations();
+		return true;
+	} else if (name == "warm_start") {
+		r_ret = get_warm_start();
+		return true;
+	} else if (name == "warm_start_blend") {
+		r_ret = get_warm_start_blend();
+		return true;
+	} else if (name == "warm_start_reset_distance") {
+		r_ret = get_warm_start_reset_distance();
+		return true;
+	} else if (name == "dirty_position_epsilon") {
+		r_ret = get_dirty_position_epsilon();
+		return true;
+	} else if (name == "dirty_angle_epsilon") {
+		r_ret = get_dirty_angle_epsilon();
+		return true;
+	} else if (name == "lod/importance") {
+		r_ret = get_lod_importance();
+		return true;
+	} else if (name == "lod/distance_near") {
+		r_ret = get_lod_distance_near();
+		return true;
+	} else if (name == "lod/distance_far") {
+		r_ret = get_lod_distance_far();
+		return true;
+	} else if (name == "lod/bounds_radius") {
+		r_ret = get_lod_bounds_radius();
+		return true;
+	} else if (name == "lod/max_frame_skip") {
+		r_ret = get_lod_max_frame_skip();
+		return true;
+	} else if (name == "time_budget_millisecond") {
+		r_ret = get_time_budget_millisecond();
+		return true;
+	} else if (name == "convergence_tolerance") {
+		r_ret = get_convergence_tolerance();
+		return true;
+	} else if (name == "scale_iterations_by_strength") {
+		r_ret = get_scale_iterations_by_strength();
+		return true;
+	} else if (name == "effector_weight_threshold") {
+		r_ret = get_effector_weight_threshold();
+		return true;
+	} else if (name == "twist_bone_count") {
+		r_ret = get_twist_bone_count();
+		return true;
+	} else if (name.begins_with("twist_bones/")) {
+		int index = name.get_slicec('/', 1).to_int();
+		String what = name.get_slicec('/', 2);
+		ERR_FAIL_INDEX_V(index, twist_bones.size(), false);
+		if (what == "name") {
+			r_ret = get_twist_bone(index);
+			return true;
+		} else if (what == "driver") {
+			r_ret = get_twist_bone_driver(index);
+			return true;
+		} else if (what == "fraction") {
+			r_ret = get_twist_bone_fraction(index);
+			return true;
+		}
 	} else if (name == "effector_count") {
 		r_ret = get_effector_count();
 		return true;
@@ -404,6 +1621,27 @@ bool SkeletonModification3DEWBIK::_get(const StringName &p_name, Variant &r_ret)
 		} else if (what == "target_transform") {
 			r_ret = get_effector_target_transform(index);
 			return true;
+		} else if (what == "enabled") {
+			r_ret = is_effector_enabled(index);
+			return true;
+		} else if (what == "weight") {
+			r_ret = get_effector_weight(index);
+			return true;
+		} else if (what == "solver_backend") {
+			r_ret = get_effector_solver_backend(index) + 1;
+			return true;
+		} else if (what == "depth_falloff") {
+			r_ret = get_effector_depth_falloff(index);
+			return true;
+		} else if (what == "budget") {
+			r_ret = get_effector_budget(index);
+			return true;
+		} else if (what == "lod_threshold") {
+			r_ret = get_effector_lod_threshold(index);
+			return true;
+		} else if (what == "update_divider") {
+			r_ret = get_effector_update_divider(index);
+			return true;
 		}
 	}
 
@@ -415,6 +1653,95 @@ bool SkeletonModification3DEWBIK::_set(const StringName &p_name, const Variant &
 	if (name == "ik_iterations") {
 		set_ik_iterations(p_value);
 		return true;
+	} else if (name == "stabilization_passes") {
+		set_stabilization_passes(p_value);
+		return true;
+	} else if (name == "iterations_per_frame") {
+		set_iterations_per_frame(p_value);
+		return true;
+	} else if (name == "over_relaxation") {
+		set_over_relaxation(p_value);
+		return true;
+	} else if (name == "solver_backend") {
+		set_solver_backend(p_value);
+		return true;
+	} else if (name == "parallel_solve") {
+		set_parallel_solve(p_value);
+		return true;
+	} else if (name == "server_solve") {
+		set_server_solve(p_value);
+		return true;
+	} else if (name == "async_solve") {
+		set_async_solve(p_value);
+		return true;
+	} else if (name == "crowd_solve") {
+		set_crowd_solve(p_value);
+		return true;
+	} else if (name == "coarse/segment_bones") {
+		set_coarse_segment_bones(p_value);
+		return true;
+	} else if (name == "coarse/iterations") {
+		set_coarse_iterations(p_value);
+		return true;
+	} else if (name == "warm_start") {
+		set_warm_start(p_value);
+		return true;
+	} else if (name == "warm_start_blend") {
+		set_warm_start_blend(p_value);
+		return true;
+	} else if (name == "warm_start_reset_distance") {
+		set_warm_start_reset_distance(p_value);
+		return true;
+	} else if (name == "dirty_position_epsilon") {
+		set_dirty_position_epsilon(p_value);
+		return true;
+	} else if (name == "dirty_angle_epsilon") {
+		set_dirty_angle_epsilon(p_value);
+		return true;
+	} else if (name == "lod/importance") {
+		set_lod_importance(p_value);
+		return true;
+	} else if (name == "lod/distance_near") {
+		set_lod_distance_near(p_value);
+		return true;
+	} else if (name == "lod/distance_far") {
+		set_lod_distance_far(p_value);
+		return true;
+	} else if (name == "lod/bounds_radius") {
+		set_lod_bounds_radius(p_value);
+		return true;
+	} else if (name == "lod/max_frame_skip") {
+		set_lod_max_frame_skip(p_value);
+		return true;
+	} else if (name == "time_budget_millisecond") {
+		set_time_budget_millisecond(p_value);
+		return true;
+	} else if (name == "convergence_tolerance") {
+		set_convergence_tolerance(p_value);
+		return true;
+	} else if (name == "scale_iterations_by_strength") {
+		set_scale_iterations_by_strength(p_value);
+		return true;
+	} else if (name == "effector_weight_threshold") {
+		set_effector_weight_threshold(p_value);
+		return true;
+	} else if (name == "twist_bone_count") {
+		set_twist_bone_count(p_value);
+		return true;
+	} else if (name.begins_with("twist_bones/")) {
+		int index = name.get_slicec('/', 1).to_int();
+		String what = name.get_slicec('/', 2);
+		ERR_FAIL_INDEX_V(index, twist_bones.size(), false);
+		if (what == "name") {
+			set_twist_bone(index, p_value);
+			return true;
+		} else if (what == "driver") {
+			set_twist_bone_driver(index, p_value);
+			return true;
+		} else if (what == "fraction") {
+			set_twist_bone_fraction(index, p_value);
+			return true;
+		}
 	} else if (name == "effector_count") {
 		set_effector_count(p_value);
 		return true;
@@ -449,6 +1776,34 @@ bool SkeletonModification3DEWBIK::_set(const StringName &p_name, const Variant &
 		} else if (what == "target_transform") {
 			set_effector_target_transform(index, p_value);
 
+			return true;
+		} else if (what == "enabled") {
+			set_effector_enabled(index, p_value);
+
+			return true;
+		} else if (what == "weight") {
+			set_effector_weight(index, p_value);
+
+			return true;
+		} else if (what == "solver_backend") {
+			set_effector_solver_backend(index, int32_t(p_value) - 1);
+
+			return true;
+		} else if (what == "depth_falloff") {
+			set_effector_depth_falloff(index, p_value);
+
+			return true;
+		} else if (what == "budget") {
+			set_effector_budget(index, p_value);
+
+			return true;
+		} else if (what == "lod_threshold") {
+			set_effector_lod_threshold(index, p_value);
+
+			return true;
+		} else if (what == "update_divider") {
+			set_effector_update_divider(index, p_value);
+
 			return true;
 		}
 	}
@@ -459,17 +1814,98 @@ bool SkeletonModification3DEWBIK::_set(const StringName &p_name, const Variant &
 void SkeletonModification3DEWBIK::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_ik_iterations"), &SkeletonModification3DEWBIK::get_ik_iterations);
 	ClassDB::bind_method(D_METHOD("set_ik_iterations", "iterations"), &SkeletonModification3DEWBIK::set_ik_iterations);
+	ClassDB::bind_method(D_METHOD("get_stabilization_passes"), &SkeletonModification3DEWBIK::get_stabilization_passes);
+	ClassDB::bind_method(D_METHOD("set_stabilization_passes", "passes"), &SkeletonModification3DEWBIK::set_stabilization_passes);
+	ClassDB::bind_method(D_METHOD("get_iterations_per_frame"), &SkeletonModification3DEWBIK::get_iterations_per_frame);
+	ClassDB::bind_method(D_METHOD("set_iterations_per_frame", "iterations"), &SkeletonModification3DEWBIK::set_iterations_per_frame);
+	ClassDB::bind_method(D_METHOD("get_pending_iterations"), &SkeletonModification3DEWBIK::get_pending_iterations);
+	ClassDB::bind_method(D_METHOD("get_over_relaxation"), &SkeletonModification3DEWBIK::get_over_relaxation);
+	ClassDB::bind_method(D_METHOD("set_over_relaxation", "factor"), &SkeletonModification3DEWBIK::set_over_relaxation);
+	ClassDB::bind_method(D_METHOD("get_solver_backend"), &SkeletonModification3DEWBIK::get_solver_backend);
+	ClassDB::bind_method(D_METHOD("set_solver_backend", "backend"), &SkeletonModification3DEWBIK::set_solver_backend);
+	ClassDB::bind_method(D_METHOD("get_effector_solver_backend", "index"), &SkeletonModification3DEWBIK::get_effector_solver_backend);
+	ClassDB::bind_method(D_METHOD("set_effector_solver_backend", "index", "backend"), &SkeletonModification3DEWBIK::set_effector_solver_backend);
+	ClassDB::bind_method(D_METHOD("get_parallel_solve"), &SkeletonModification3DEWBIK::get_parallel_solve);
+	ClassDB::bind_method(D_METHOD("set_parallel_solve", "enabled"), &SkeletonModification3DEWBIK::set_parallel_solve);
+	ClassDB::bind_method(D_METHOD("get_server_solve"), &SkeletonModification3DEWBIK::get_server_solve);
+	ClassDB::bind_method(D_METHOD("set_server_solve", "enabled"), &SkeletonModification3DEWBIK::set_server_solve);
+	ClassDB::bind_method(D_METHOD("get_async_solve"), &SkeletonModification3DEWBIK::get_async_solve);
+	ClassDB::bind_method(D_METHOD("set_async_solve", "enabled"), &SkeletonModification3DEWBIK::set_async_solve);
+	ClassDB::bind_method(D_METHOD("get_crowd_solve"), &SkeletonModification3DEWBIK::get_crowd_solve);
+	ClassDB::bind_method(D_METHOD("set_crowd_solve", "enabled"), &SkeletonModification3DEWBIK::set_crowd_solve);
+	ClassDB::bind_method(D_METHOD("is_crowd_packable"), &SkeletonModification3DEWBIK::is_crowd_packable);
+	ClassDB::bind_method(D_METHOD("get_coarse_segment_bones"), &SkeletonModification3DEWBIK::get_coarse_segment_bones);
+	ClassDB::bind_method(D_METHOD("set_coarse_segment_bones", "bones"), &SkeletonModification3DEWBIK::set_coarse_segment_bones);
+	ClassDB::bind_method(D_METHOD("get_coarse_iterations"), &SkeletonModification3DEWBIK::get_coarse_iterations);
+	ClassDB::bind_method(D_METHOD("set_coarse_iterations", "iterations"), &SkeletonModification3DEWBIK::set_coarse_iterations);
+	ClassDB::bind_method(D_METHOD("get_warm_start"), &SkeletonModification3DEWBIK::get_warm_start);
+	ClassDB::bind_method(D_METHOD("set_warm_start", "enabled"), &SkeletonModification3DEWBIK::set_warm_start);
+	ClassDB::bind_method(D_METHOD("get_warm_start_blend"), &SkeletonModification3DEWBIK::get_warm_start_blend);
+	ClassDB::bind_method(D_METHOD("set_warm_start_blend", "blend"), &SkeletonModification3DEWBIK::set_warm_start_blend);
+	ClassDB::bind_method(D_METHOD("get_warm_start_reset_distance"), &SkeletonModification3DEWBIK::get_warm_start_reset_distance);
+	ClassDB::bind_method(D_METHOD("set_warm_start_reset_distance", "distance"), &SkeletonModification3DEWBIK::set_warm_start_reset_distance);
+	ClassDB::bind_method(D_METHOD("is_warm_started"), &SkeletonModification3DEWBIK::is_warm_started);
+	ClassDB::bind_method(D_METHOD("get_dirty_position_epsilon"), &SkeletonModification3DEWBIK::get_dirty_position_epsilon);
+	ClassDB::bind_method(D_METHOD("set_dirty_position_epsilon", "epsilon"), &SkeletonModification3DEWBIK::set_dirty_position_epsilon);
+	ClassDB::bind_method(D_METHOD("get_dirty_angle_epsilon"), &SkeletonModification3DEWBIK::get_dirty_angle_epsilon);
+	ClassDB::bind_method(D_METHOD("set_dirty_angle_epsilon", "epsilon"), &SkeletonModification3DEWBIK::set_dirty_angle_epsilon);
+	ClassDB::bind_method(D_METHOD("get_lod_importance"), &SkeletonModification3DEWBIK::get_lod_importance);
+	ClassDB::bind_method(D_METHOD("set_lod_importance", "importance"), &SkeletonModification3DEWBIK::set_lod_importance);
+	ClassDB::bind_method(D_METHOD("get_lod_distance_near"), &SkeletonModification3DEWBIK::get_lod_distance_near);
+	ClassDB::bind_method(D_METHOD("set_lod_distance_near", "distance"), &SkeletonModification3DEWBIK::set_lod_distance_near);
+	ClassDB::bind_method(D_METHOD("get_lod_distance_far"), &SkeletonModification3DEWBIK::get_lod_distance_far);
+	ClassDB::bind_method(D_METHOD("set_lod_distance_far", "distance"), &SkeletonModification3DEWBIK::set_lod_distance_far);
+	ClassDB::bind_method(D_METHOD("get_lod_bounds_radius"), &SkeletonModification3DEWBIK::get_lod_bounds_radius);
+	ClassDB::bind_method(D_METHOD("set_lod_bounds_radius", "radius"), &SkeletonModification3DEWBIK::set_lod_bounds_radius);
+	ClassDB::bind_method(D_METHOD("get_lod_max_frame_skip"), &SkeletonModification3DEWBIK::get_lod_max_frame_skip);
+	ClassDB::bind_method(D_METHOD("set_lod_max_frame_skip", "frames"), &SkeletonModification3DEWBIK::set_lod_max_frame_skip);
+	ClassDB::bind_method(D_METHOD("get_lod_factor"), &SkeletonModification3DEWBIK::get_lod_factor);
+	ClassDB::bind_method(D_METHOD("get_time_budget_millisecond"), &SkeletonModification3DEWBIK::get_time_budget_millisecond);
+	ClassDB::bind_method(D_METHOD("set_time_budget_millisecond", "budget"), &SkeletonModification3DEWBIK::set_time_budget_millisecond);
+	ClassDB::bind_method(D_METHOD("get_convergence_tolerance"), &SkeletonModification3DEWBIK::get_convergence_tolerance);
+	ClassDB::bind_method(D_METHOD("set_convergence_tolerance", "tolerance"), &SkeletonModification3DEWBIK::set_convergence_tolerance);
+	ClassDB::bind_method(D_METHOD("get_scale_iterations_by_strength"), &SkeletonModification3DEWBIK::get_scale_iterations_by_strength);
+	ClassDB::bind_method(D_METHOD("set_scale_iterations_by_strength", "enabled"), &SkeletonModification3DEWBIK::set_scale_iterations_by_strength);
+	ClassDB::bind_method(D_METHOD("get_last_iteration_count"), &SkeletonModification3DEWBIK::get_last_iteration_count);
+	ClassDB::bind_method(D_METHOD("get_last_coarse_iteration_count"), &SkeletonModification3DEWBIK::get_last_coarse_iteration_count);
+	ClassDB::bind_method(D_METHOD("get_budget_used_millisecond"), &SkeletonModification3DEWBIK::get_budget_used_millisecond);
+	ClassDB::bind_method(D_METHOD("is_converged"), &SkeletonModification3DEWBIK::is_converged);
+	ClassDB::bind_method(D_METHOD("is_target_reachable"), &SkeletonModification3DEWBIK::is_target_reachable);
 	ClassDB::bind_method(D_METHOD("set_root_bone", "root_bone"), &SkeletonModification3DEWBIK::set_root_bone);
 	ClassDB::bind_method(D_METHOD("get_root_bone"), &SkeletonModification3DEWBIK::get_root_bone);
+	ClassDB::bind_method(D_METHOD("get_root_count"), &SkeletonModification3DEWBIK::get_root_count);
+	ClassDB::bind_method(D_METHOD("set_frozen_bones", "bones"), &SkeletonModification3DEWBIK::set_frozen_bones);
+	ClassDB::bind_method(D_METHOD("get_frozen_bones"), &SkeletonModification3DEWBIK::get_frozen_bones);
+	ClassDB::bind_method(D_METHOD("set_twist_bone_count", "count"), &SkeletonModification3DEWBIK::set_twist_bone_count);
+	ClassDB::bind_method(D_METHOD("get_twist_bone_count"), &SkeletonModification3DEWBIK::get_twist_bone_count);
+	ClassDB::bind_method(D_METHOD("add_twist_bone", "name", "driver", "fraction"), &SkeletonModification3DEWBIK::add_twist_bone, DEFVAL(0.5));
+	ClassDB::bind_method(D_METHOD("set_effector_weight_threshold", "threshold"), &SkeletonModification3DEWBIK::set_effector_weight_threshold);
+	ClassDB::bind_method(D_METHOD("get_effector_weight_threshold"), &SkeletonModification3DEWBIK::get_effector_weight_threshold);
+	ClassDB::bind_method(D_METHOD("get_heading_report"), &SkeletonModification3DEWBIK::get_heading_report);
 	ClassDB::bind_method(D_METHOD("get_effector_count"), &SkeletonModification3DEWBIK::get_effector_count);
 	ClassDB::bind_method(D_METHOD("set_effector_count", "count"),
 			&SkeletonModification3DEWBIK::set_effector_count);
 	ClassDB::bind_method(D_METHOD("add_effector", "name", "target_node", "target_transform", "budget"), &SkeletonModification3DEWBIK::add_effector);
 	ClassDB::bind_method(D_METHOD("get_effector", "index"), &SkeletonModification3DEWBIK::get_effector);
 	ClassDB::bind_method(D_METHOD("set_effector", "index", "effector"), &SkeletonModification3DEWBIK::set_effector);
+	ClassDB::bind_method(D_METHOD("set_effector_enabled", "index", "enabled"), &SkeletonModification3DEWBIK::set_effector_enabled);
+	ClassDB::bind_method(D_METHOD("is_effector_enabled", "index"), &SkeletonModification3DEWBIK::is_effector_enabled);
+	ClassDB::bind_method(D_METHOD("set_effector_weight", "index", "weight"), &SkeletonModification3DEWBIK::set_effector_weight);
+	ClassDB::bind_method(D_METHOD("get_effector_weight", "index"), &SkeletonModification3DEWBIK::get_effector_weight);
+	ClassDB::bind_method(D_METHOD("set_effector_depth_falloff", "index", "falloff"), &SkeletonModification3DEWBIK::set_effector_depth_falloff);
+	ClassDB::bind_method(D_METHOD("get_effector_depth_falloff", "index"), &SkeletonModification3DEWBIK::get_effector_depth_falloff);
+	ClassDB::bind_method(D_METHOD("set_effector_budget", "index", "budget"), &SkeletonModification3DEWBIK::set_effector_budget);
+	ClassDB::bind_method(D_METHOD("get_effector_budget", "index"), &SkeletonModification3DEWBIK::get_effector_budget);
+	ClassDB::bind_method(D_METHOD("set_effector_lod_threshold", "index", "threshold"), &SkeletonModification3DEWBIK::set_effector_lod_threshold);
+	ClassDB::bind_method(D_METHOD("get_effector_lod_threshold", "index"), &SkeletonModification3DEWBIK::get_effector_lod_threshold);
+	ClassDB::bind_method(D_METHOD("set_effector_update_divider", "index", "divider"), &SkeletonModification3DEWBIK::set_effector_update_divider);
+	ClassDB::bind_method(D_METHOD("get_effector_update_divider", "index"), &SkeletonModification3DEWBIK::get_effector_update_divider);
+	ClassDB::bind_method(D_METHOD("get_effector_reach", "index"), &SkeletonModification3DEWBIK::get_effector_reach);
+	ClassDB::bind_method(D_METHOD("is_effector_reachable", "index"), &SkeletonModification3DEWBIK::is_effector_reachable);
 	ClassDB::bind_method(D_METHOD("update_skeleton"), &SkeletonModification3DEWBIK::update_skeleton);
 
 	ADD_PROPERTY(PropertyInfo(Variant::STRING_NAME, "root_bone"), "set_root_bone", "get_root_bone");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_STRING_ARRAY, "frozen_bones"), "set_frozen_bones", "get_frozen_bones");
 }
 
 SkeletonModification3DEWBIK::SkeletonModification3DEWBIK() {
@@ -477,4 +1913,8 @@ SkeletonModification3DEWBIK::SkeletonModification3DEWBIK() {
 }
 
 SkeletonModification3DEWBIK::~SkeletonModification3DEWBIK() {
+	IKTaskScheduler::wait(async_task);
+	if (server_rig.is_valid() && EWBIKServer::get_singleton()) {
+		EWBIKServer::get_singleton()->rig_free(server_rig);
+	}
 }
@@ -33,35 +33,151 @@
 
 #include "core/object/reference.h"
 #include "core/os/memory.h"
+#include "core/templates/rid.h"
 #include "ik_bone_chain.h"
+#include "ik_task_scheduler.h"
 #include "scene/resources/skeleton_modification_3d.h"
 
 class SkeletonModification3DEWBIK : public SkeletonModification3D {
 	GDCLASS(SkeletonModification3DEWBIK, SkeletonModification3D);
 
 private:
+	struct TwistBone {
+		String name;
+		String driver;
+		real_t fraction = 0.5;
+	};
+
 	Skeleton3D *skeleton = nullptr;
 	String root_bone;
 	BoneId root_bone_index = -1;
-	Ref<IKBoneChain> segmented_skeleton;
+	// One chain tree per solved root. Roots share no bones, so their trees are solved independently.
+	Vector<Ref<IKBoneChain>> segmented_skeletons;
 	int32_t effector_count = 0;
+	real_t effector_weight_threshold = 0.0;
 	Vector<Ref<IKBone3D>> multi_effector;
 	HashMap<BoneId, Ref<IKBone3D>> effectors_map;
 	Vector<Ref<IKBone3D>> bone_list;
+	PackedStringArray frozen_bones;
+	Vector<TwistBone> twist_bones;
+	Vector<Ref<IKBone3D>> twist_bone_list;
 	bool is_dirty = true;
 	bool calc_done = false;
+	bool weights_dirty = true;
+	// Inputs of the last frame, compared one by one, so a change can't hide behind a hash collision.
+	Vector<Transform> input_snapshot;
+	real_t input_strength = -1.0;
 
 	// Task
 	int32_t ik_iterations = 15;
-	int32_t stabilization_passes = 1;
+	// Each pass costs another QCP fit and heading update per bone, so they are opt-in.
+	int32_t stabilization_passes = 0;
+	real_t time_budget_millisecond = 0.0;
+	real_t convergence_tolerance = 0.001;
+	bool scale_iterations_by_strength = false;
+	real_t blend_strength = 1.0;
+	real_t over_relaxation = 1.0;
+	IKSolverBackend::Type solver_backend = IKSolverBackend::TYPE_QCP;
+	int32_t coarse_segment_bones = 0;
+	bool parallel_solve = false;
+	bool server_solve = false;
+	RID server_rig;
+	// Rigs with the same signature solve together in the lanes of one server task.
+	bool crowd_solve = false;
+	uint32_t crowd_signature = 0;
+
+	// Between gather_solve and scatter_solve the solve works from the gathered input pose and leaves
+	// its result in solved_rotations. It still runs on the shadow bone and chain References of this
+	// modification, it just never reads the skeleton or the scene tree.
+	Vector<Transform> input_pose;
+	Vector<Quat> solved_rotations;
+
+	// Asynchronous solve, the worker fills solved_rotations while the front buffer is applied.
+	bool async_solve = false;
+	IKTaskScheduler::AsyncTask async_task;
+	bool async_pending = false;
+	Vector<Quat> front_rotations;
+	real_t front_strength = 1.0;
+	int32_t coarse_iterations = 4;
+	int32_t iterations_per_frame = 0;
+	int32_t pending_iterations = 0;
+	real_t input_motion = 0.0;
+	bool warm_start = false;
+	real_t warm_start_blend = 0.9;
+	real_t warm_start_reset_distance = 0.5;
+	bool has_solution = false;
+	real_t dirty_position_epsilon = 0.0;
+	real_t dirty_angle_epsilon = 0.0;
+	uint64_t solve_frame = 0;
+	bool has_deferred_effectors = false;
+
+	// Level of detail
+	real_t lod_importance = 1.0;
+	real_t lod_distance_near = 0.0;
+	real_t lod_distance_far = 0.0;
+	real_t lod_bounds_radius = 2.0;
+	int32_t lod_max_frame_skip = 0;
+	real_t lod_factor = 1.0;
+	uint64_t lod_frame = 0;
+
+	// Statistics of the last solve
+	int32_t last_iteration_count = 0;
+	int32_t last_coarse_iteration_count = 0;
+	real_t budget_used_millisecond = 0.0;
+	bool converged = false;
+	bool targets_reachable = true;
+	bool warm_started = false;
+
+	// Stop and over-relaxation state of one solve's iterations, shared by the scalar and the lane loops.
+	struct IterationState {
+		uint64_t start_usec = 0;
+		uint64_t budget_usec = 0;
+		int32_t iterations = 0;
+		real_t relaxation = 1.0;
+		real_t prev_error = MAXFLOAT;
+		bool done = false;
+	};
+
+	struct RootWork {
+		SkeletonModification3DEWBIK *modification = nullptr;
+		int32_t stabilization_passes = 0;
+		real_t relaxation = 1.0;
+		int32_t coarse_bones = 1;
+	};
 
+	Vector<BoneId> get_solved_roots() const;
 	void update_segments();
 	void update_effectors_map();
 	void update_bone_list();
+	void update_twist_bones();
+	Ref<IKBone3D> find_shadow_bone(BoneId p_bone) const;
 	void generate_default_effectors();
+	void update_effector_weights();
+	void update_crowd_signature();
 	void update_shadow_bones_transform();
-	void update_skeleton_bones_transform(real_t p_blending_delta);
+	void update_solved_rotations();
+	void scatter_rotations(const Vector<Quat> &p_rotations, real_t p_blending_delta);
+	void complete_solve(bool p_solved);
+	static void _async_solve(void *p_self, uint32_t p_index);
+	void finish_async_solve();
 	bool is_calc_done();
+	void get_input_snapshot(Vector<Transform> &r_snapshot) const;
+	void begin_solve();
+	bool schedule_effectors(real_t &r_total_error);
+	void begin_iterations(IterationState &r_state, uint64_t p_start_usec);
+	bool next_iteration(IterationState &r_state);
+	bool next_coarse_iteration(IterationState &r_state);
+	bool is_over_budget(const IterationState &p_state) const;
+	void end_iterations(const IterationState &r_state);
+	real_t update_lod_factor() const;
+	bool has_later_modifications() const;
+	int32_t get_scaled_iterations() const;
+	int32_t get_scaled_coarse_iterations() const;
+	real_t get_scaled_tolerance() const;
+	real_t get_strength_factor() const;
+	Ref<IKBoneChain> find_segment_containing(const Ref<IKBone3D> &p_bone) const;
+	void grouped_root_solver(int32_t p_stabilization_passes, real_t p_relaxation, int32_t p_coarse_bones);
+	static void _solve_root(void *p_work, uint32_t p_index);
 
 protected:
 	virtual void _validate_property(PropertyInfo &property) const override;
@@ -75,10 +191,81 @@ protected:
 public:
 	void set_ik_iterations(int32_t p_iterations);
 	int32_t get_ik_iterations() const;
+	void set_stabilization_passes(int32_t p_passes);
+	int32_t get_stabilization_passes() const;
+	void set_time_budget_millisecond(real_t p_budget);
+	real_t get_time_budget_millisecond() const;
+	void set_convergence_tolerance(real_t p_tolerance);
+	real_t get_convergence_tolerance() const;
+	void set_scale_iterations_by_strength(bool p_enabled);
+	bool get_scale_iterations_by_strength() const;
+	void set_iterations_per_frame(int32_t p_iterations);
+	int32_t get_iterations_per_frame() const;
+	int32_t get_pending_iterations();
+	void set_over_relaxation(real_t p_factor);
+	real_t get_over_relaxation() const;
+	void set_solver_backend(int32_t p_backend);
+	int32_t get_solver_backend() const;
+	void set_parallel_solve(bool p_enabled);
+	bool get_parallel_solve() const;
+	void set_server_solve(bool p_enabled);
+	bool get_server_solve() const;
+	void set_async_solve(bool p_enabled);
+	bool get_async_solve() const;
+	void set_crowd_solve(bool p_enabled);
+	bool get_crowd_solve() const;
+	bool is_crowd_packable() const;
+	uint32_t get_crowd_signature() const;
+	void set_coarse_segment_bones(int32_t p_bones);
+	int32_t get_coarse_segment_bones() const;
+	void set_coarse_iterations(int32_t p_iterations);
+	int32_t get_coarse_iterations() const;
+	void set_warm_start(bool p_enabled);
+	bool get_warm_start() const;
+	void set_warm_start_blend(real_t p_blend);
+	real_t get_warm_start_blend() const;
+	void set_warm_start_reset_distance(real_t p_distance);
+	real_t get_warm_start_reset_distance() const;
+	bool is_warm_started();
+	void set_dirty_position_epsilon(real_t p_epsilon);
+	real_t get_dirty_position_epsilon() const;
+	void set_dirty_angle_epsilon(real_t p_epsilon);
+	real_t get_dirty_angle_epsilon() const;
+	void set_lod_importance(real_t p_importance);
+	real_t get_lod_importance() const;
+	void set_lod_distance_near(real_t p_distance);
+	real_t get_lod_distance_near() const;
+	void set_lod_distance_far(real_t p_distance);
+	real_t get_lod_distance_far() const;
+	void set_lod_bounds_radius(real_t p_radius);
+	real_t get_lod_bounds_radius() const;
+	void set_lod_max_frame_skip(int32_t p_frames);
+	int32_t get_lod_max_frame_skip() const;
+	real_t get_lod_factor() const;
+	int32_t get_last_iteration_count();
+	int32_t get_last_coarse_iteration_count();
+	real_t get_budget_used_millisecond();
+	bool is_converged();
+	bool is_target_reachable();
 	void set_root_bone(const String &p_root_bone);
 	String get_root_bone() const;
 	void set_root_bone_index(BoneId p_index);
 	BoneId get_root_bone_index() const;
+	int32_t get_root_count() const;
+	void set_frozen_bones(const PackedStringArray &p_bones);
+	PackedStringArray get_frozen_bones() const;
+	void set_twist_bone_count(int32_t p_count);
+	int32_t get_twist_bone_count() const;
+	void add_twist_bone(const String &p_name, const String &p_driver, real_t p_fraction = 0.5);
+	void set_twist_bone(int32_t p_index, const String &p_name);
+	String get_twist_bone(int32_t p_index) const;
+	void set_twist_bone_driver(int32_t p_index, const String &p_driver);
+	String get_twist_bone_driver(int32_t p_index) const;
+	void set_twist_bone_fraction(int32_t p_index, real_t p_fraction);
+	real_t get_twist_bone_fraction(int32_t p_index) const;
+	void set_effector_weight_threshold(real_t p_threshold);
+	real_t get_effector_weight_threshold() const;
+	Dictionary get_heading_report() const;
 	void set_effector_count(int32_t p_value);
 	int32_t get_effector_count() const;
 	void add_effector(const String &p_name, const NodePath &p_target_node = NodePath(),
@@ -97,12 +284,32 @@ public:
 	Transform get_effector_target_transform(int32_t p_index) const;
 	void set_effector_use_node_rotation(int32_t p_index, bool p_use_node_rot);
 	bool get_effector_use_node_rotation(int32_t p_index) const;
+	void set_effector_enabled(int32_t p_index, bool p_enabled);
+	bool is_effector_enabled(int32_t p_index) const;
+	void set_effector_weight(int32_t p_index, real_t p_weight);
+	real_t get_effector_weight(int32_t p_index) const;
+	void set_effector_solver_backend(int32_t p_index, int32_t p_backend);
+	int32_t get_effector_solver_backend(int32_t p_index) const;
+	void set_effector_depth_falloff(int32_t p_index, real_t p_falloff);
+	real_t get_effector_depth_falloff(int32_t p_index) const;
+	void set_effector_budget(int32_t p_index, real_t p_budget);
+	real_t get_effector_budget(int32_t p_index) const;
+	void set_effector_lod_threshold(int32_t p_index, real_t p_threshold);
+	real_t get_effector_lod_threshold(int32_t p_index) const;
+	void set_effector_update_divider(int32_t p_index, int32_t p_divider);
+	int32_t get_effector_update_divider(int32_t p_index) const;
+	real_t get_effector_reach(int32_t p_index) const;
+	bool is_effector_reachable(int32_t p_index);
 	void update_skeleton();
 
 	virtual void execute(float delta) override;
 	virtual void setup_modification(SkeletonModificationStack3D *p_stack) override;
 
 	void solve(real_t p_blending_delta);
+	bool gather_solve(real_t p_blending_delta);
+	void solve_gathered();
+	static void solve_gathered_lanes(SkeletonModification3DEWBIK *const *p_rigs, int32_t p_count);
+	void scatter_solve(bool p_gathered);
 	void iterated_improved_solver();
 
 	SkeletonModification3DEWBIK();
@@ -31,7 +31,13 @@
 #ifndef TEST_EWBIK_H
 #define TEST_EWBIK_H
 
-#include "modules/ewbik/qcp.h"
+#include "core/os/os.h"
+#include "modules/ewbik/ewbik_server.h"
+#include "modules/ewbik/ik_task_scheduler.h"
+#include "modules/ewbik/math/qcp.h"
+#include "modules/ewbik/math/qcp_lanes.h"
+#include "modules/ewbik/skeleton_modification_3d_ewbik.h"
+#include "scene/3d/skeleton_3d.h"
 
 #include "tests/test_macros.h"
 
@@ -46,44 +52,917 @@ Vector3 rad2deg(const Vector3 &p_rotation) {
 }
 
 TEST_CASE("[Modules][EWBIK] qcp") {
-	Ref<QCP> qcp;
-	qcp.instance();
-	qcp->set_max_iterations(10);
-
-	Vector<Vector3> localizedTipHeadings;
-	localizedTipHeadings.push_back(Vector3(0.0, 0.0, 0.0));
-	localizedTipHeadings.push_back(Vector3(0.5219288, 0.1455288, 0.8404827));
-	localizedTipHeadings.push_back(Vector3(-0.5219288, -0.1455288, -0.8404827));
-	localizedTipHeadings.push_back(Vector3(0.0012719706, -0.9854698, 0.16984463));
-	localizedTipHeadings.push_back(Vector3(-0.0012719706, 0.9854698, -0.16984463));
-	localizedTipHeadings.push_back(Vector3(0.8529882, -0.08757782, -0.5145302));
-	localizedTipHeadings.push_back(Vector3(-0.8529882, 0.08757782, 0.5145302));
-
-	Vector<Vector3> localizedTargetHeadings;
-	localizedTargetHeadings.push_back(Vector3(0.014951646, -0.2548256, -0.0037765503));
-	localizedTargetHeadings.push_back(Vector3(0.66200894, -0.12242699, 0.7470808));
-	localizedTargetHeadings.push_back(Vector3(-0.63210565, -0.3872242, -0.7546339));
-	localizedTargetHeadings.push_back(Vector3(0.01495599, -1.2396336, 0.16987133));
-	localizedTargetHeadings.push_back(Vector3(0.014947303, 0.7299824, -0.17742443));
-	localizedTargetHeadings.push_back(Vector3(0.777393, -0.36718178, -0.64100456));
-	localizedTargetHeadings.push_back(Vector3(-0.7474897, -0.1424694, 0.63345146));
-
-	Vector<float> weights;
+	PackedVector3Array tip_headings;
+	tip_headings.push_back(Vector3(0.0, 0.0, 0.0));
+	tip_headings.push_back(Vector3(0.5219288, 0.1455288, 0.8404827));
+	tip_headings.push_back(Vector3(-0.5219288, -0.1455288, -0.8404827));
+	tip_headings.push_back(Vector3(0.0012719706, -0.9854698, 0.16984463));
+	tip_headings.push_back(Vector3(-0.0012719706, 0.9854698, -0.16984463));
+	tip_headings.push_back(Vector3(0.8529882, -0.08757782, -0.5145302));
+	tip_headings.push_back(Vector3(-0.8529882, 0.08757782, 0.5145302));
+
+	Vector<real_t> weights;
 	weights.push_back(5.0);
-	weights.push_back(25.0);
-	weights.push_back(25.0);
-	weights.push_back(25.0);
-	weights.push_back(25.0);
-	weights.push_back(25.0);
-	weights.push_back(25.0);
-	Quat rot = qcp->weighted_superpose(localizedTipHeadings, localizedTargetHeadings,
-			weights, false);
-	Quat rot_compare;
-	rot_compare.w = 0.99715185;
-	rot_compare.x = 0.0019268756;
-	rot_compare.y = -0.07416658;
-	rot_compare.z = 0.013555937;
-	CHECK_MESSAGE(rot.is_equal_approx(rot_compare), vformat("%s does not match quaternion.", String(rot)).utf8().ptr());
+	for (int32_t i = 1; i < tip_headings.size(); i++) {
+		weights.push_back(25.0);
+	}
+
+	Quat rot_compare = Quat(Vector3(0.2, -1.0, 0.4).normalized(), 0.7);
+	PackedVector3Array target_headings;
+	for (int32_t i = 0; i < tip_headings.size(); i++) {
+		target_headings.push_back(rot_compare.xform(tip_headings[i]));
+	}
+
+	QCP qcp;
+	Quat rot;
+	real_t sqrmsd = qcp.calc_optimal_rotation(tip_headings, target_headings, weights, rot);
+	CHECK(sqrmsd < 0.001);
+	// Both signs describe the same rotation.
+	CHECK_MESSAGE(Math::is_equal_approx(Math::abs(rot.dot(rot_compare)), real_t(1.0)), vformat("%s does not match quaternion.", String(rot)).utf8().ptr());
+	for (int32_t i = 0; i < tip_headings.size(); i++) {
+		CHECK(rot.xform(tip_headings[i]).is_equal_approx(target_headings[i]));
+	}
+}
+
+Skeleton3D *create_chain_skeleton(int32_t p_bone_count, real_t p_bone_length) {
+	Skeleton3D *skeleton = memnew(Skeleton3D);
+	for (int32_t bone_i = 0; bone_i < p_bone_count; bone_i++) {
+		skeleton->add_bone("bone_" + itos(bone_i));
+		if (bone_i > 0) {
+			skeleton->set_bone_parent(bone_i, bone_i - 1);
+			skeleton->set_bone_rest(bone_i, Transform(Basis(), Vector3(0.0, p_bone_length, 0.0)));
+		}
+	}
+	return skeleton;
+}
+
+// Puts a modification on a stack of its own, once the skeleton has all its bones, and builds its chains.
+Ref<SkeletonModification3DEWBIK> create_modification(Skeleton3D *p_skeleton, const Vector<String> &p_effector_bones, const Vector<Transform> &p_targets) {
+	Ref<SkeletonModificationStack3D> stack;
+	stack.instance();
+	Ref<SkeletonModification3DEWBIK> ewbik;
+	ewbik.instance();
+	stack->add_modification(ewbik);
+	p_skeleton->set_modification_stack(stack);
+	ewbik->setup_modification(stack.ptr());
+	for (int32_t effector_i = 0; effector_i < p_effector_bones.size(); effector_i++) {
+		ewbik->add_effector(p_effector_bones[effector_i], NodePath(), false, p_targets[effector_i]);
+	}
+	ewbik->update_skeleton();
+	return ewbik;
+}
+
+Ref<SkeletonModification3DEWBIK> create_chain_modification(Skeleton3D *p_skeleton, const Transform &p_target) {
+	Vector<String> effector_bones;
+	effector_bones.push_back(p_skeleton->get_bone_name(p_skeleton->get_bone_count() - 1));
+	Vector<Transform> targets;
+	targets.push_back(p_target);
+	return create_modification(p_skeleton, effector_bones, targets);
+}
+
+TEST_CASE("[Modules][EWBIK] Stabilization passes never worsen the solve") {
+	Skeleton3D *skeleton = create_chain_skeleton(10, 0.25);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(1.0, -0.5, 0.5)));
+	CHECK(ewbik->get_stabilization_passes() == 0);
+	ewbik->set_ik_iterations(10);
+	ewbik->set_convergence_tolerance(0.0);
+
+	real_t prev_error = MAXFLOAT;
+	for (int32_t passes = 0; passes <= 3; passes++) {
+		ewbik->set_stabilization_passes(passes);
+		ewbik->solve(1.0);
+		CHECK(ewbik->get_last_iteration_count() == 10);
+		// A pass that doesn't bring the headings closer is undone, so more passes can't end further away.
+		real_t error = ewbik->get_effector(0)->get_effector()->get_error();
+		CHECK(error <= prev_error + CMP_EPSILON);
+		prev_error = error;
+	}
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Effector error doesn't depend on the rig scale") {
+	real_t errors[2];
+	for (int32_t scale_i = 0; scale_i < 2; scale_i++) {
+		real_t scale = scale_i == 0 ? 1.0 : 10.0;
+		Skeleton3D *skeleton = create_chain_skeleton(10, 0.25 * scale);
+		Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(1.0, -0.5, 0.5) * scale));
+		ewbik->set_ik_iterations(3);
+		ewbik->set_convergence_tolerance(0.0);
+		ewbik->solve(1.0);
+		errors[scale_i] = ewbik->get_effector(0)->get_effector()->get_error();
+		memdelete(skeleton);
+	}
+	CHECK(errors[0] > 0.0);
+	CHECK(Math::is_equal_approx(errors[0], errors[1], real_t(0.001)));
+}
+
+TEST_CASE("[Modules][EWBIK] Over-relaxation iterations to tolerance on a long chain") {
+	Skeleton3D *skeleton = create_chain_skeleton(30, 0.1);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(1.2, -1.0, 0.6)));
+	ewbik->set_ik_iterations(200);
+	ewbik->set_convergence_tolerance(0.01);
+
+	ewbik->set_over_relaxation(1.0);
+	ewbik->solve(1.0);
+	int32_t plain_iterations = ewbik->get_last_iteration_count();
+
+	ewbik->set_over_relaxation(1.6);
+	ewbik->solve(1.0);
+	int32_t relaxed_iterations = ewbik->get_last_iteration_count();
+
+	CHECK(relaxed_iterations < plain_iterations);
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Warm start iterations under a slowly moving target") {
+	Skeleton3D *skeleton = create_chain_skeleton(10, 0.25);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(1.0, -0.5, 0.5)));
+	ewbik->set_ik_iterations(100);
+	ewbik->set_convergence_tolerance(0.01);
+
+	int32_t cold_iterations = 0;
+	int32_t warm_iterations = 0;
+	for (int32_t mode = 0; mode < 2; mode++) {
+		ewbik->set_warm_start(mode == 1);
+		for (int32_t frame = 0; frame < 10; frame++) {
+			ewbik->set_effector_target_transform(0, Transform(Basis(), Vector3(1.0, -0.5, 0.5 + frame * 0.01)));
+			ewbik->solve(1.0);
+			if (frame > 0) {
+				(mode == 1 ? warm_iterations : cold_iterations) += ewbik->get_last_iteration_count();
+			}
+		}
+	}
+
+	CHECK(ewbik->is_warm_started());
+	CHECK(warm_iterations < cold_iterations);
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Amortized solve caps iterations per frame") {
+	Skeleton3D *skeleton = create_chain_skeleton(10, 0.25);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(1.0, -0.5, 0.5)));
+	ewbik->set_ik_iterations(16);
+	ewbik->set_convergence_tolerance(0.0);
+	ewbik->set_iterations_per_frame(4);
+
+	for (int32_t frame = 0; frame < 4; frame++) {
+		ewbik->solve(1.0);
+		CHECK(ewbik->get_last_iteration_count() <= 4);
+	}
+	CHECK(ewbik->get_pending_iterations() == 0);
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Amortized solve completes under a moving target") {
+	Skeleton3D *skeleton = create_chain_skeleton(10, 0.25);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(1.0, -0.5, 0.5)));
+	ewbik->set_ik_iterations(16);
+	ewbik->set_convergence_tolerance(0.0);
+	ewbik->set_iterations_per_frame(4);
+
+	// Small moves stay under the warm start reset distance, so the count carries over instead of starting again.
+	for (int32_t frame = 0; frame < 4; frame++) {
+		ewbik->set_effector_target_transform(0, Transform(Basis(), Vector3(1.0, -0.5, 0.5 + frame * 0.01)));
+		ewbik->solve(1.0);
+		CHECK(ewbik->get_last_iteration_count() == 4);
+		CHECK(ewbik->get_pending_iterations() == 12 - frame * 4);
+	}
+	CHECK(ewbik->get_effector(0)->get_effector()->get_error() < 0.05);
+
+	// A jump past the reset distance begins a new count.
+	ewbik->set_effector_target_transform(0, Transform(Basis(), Vector3(-1.0, -0.5, 0.5)));
+	ewbik->solve(1.0);
+	CHECK(ewbik->get_pending_iterations() == 12);
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Coarse to fine solve of a dense chain") {
+	Skeleton3D *skeleton = create_chain_skeleton(120, 0.025);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(1.5, 1.0, -0.8)));
+	ewbik->set_ik_iterations(400);
+	ewbik->set_convergence_tolerance(0.01);
+
+	ewbik->solve(1.0);
+	int32_t flat_iterations = ewbik->get_last_iteration_count();
+	CHECK(ewbik->is_converged());
+
+	ewbik->set_coarse_segment_bones(8);
+	ewbik->set_coarse_iterations(6);
+	ewbik->solve(1.0);
+	int32_t fine_iterations = ewbik->get_last_iteration_count();
+	int32_t coarse_iterations = ewbik->get_last_coarse_iteration_count();
+	CHECK(ewbik->is_converged());
+	CHECK(coarse_iterations > 0);
+	CHECK(coarse_iterations + fine_iterations < flat_iterations);
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Coarse iterations follow strength and amortization") {
+	Skeleton3D *skeleton = create_chain_skeleton(40, 0.05);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(1.0, 0.8, -0.6)));
+	ewbik->set_ik_iterations(20);
+	ewbik->set_convergence_tolerance(0.0);
+	ewbik->set_coarse_segment_bones(8);
+	ewbik->set_coarse_iterations(6);
+	ewbik->set_scale_iterations_by_strength(true);
+
+	ewbik->solve(0.5);
+	CHECK(ewbik->get_last_coarse_iteration_count() == 3);
+	CHECK(ewbik->get_last_iteration_count() == 10);
+
+	// An amortized frame caps the coarse and the regular iterations together.
+	ewbik->set_scale_iterations_by_strength(false);
+	ewbik->set_iterations_per_frame(4);
+	ewbik->solve(1.0);
+	CHECK(ewbik->get_last_coarse_iteration_count() == 4);
+	CHECK(ewbik->get_last_iteration_count() == 0);
+	CHECK(ewbik->get_pending_iterations() == 20);
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Frozen bones keep their input pose") {
+	Skeleton3D *skeleton = create_chain_skeleton(8, 0.25);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(1.0, 1.0, 0.0)));
+	PackedStringArray frozen_bones;
+	frozen_bones.push_back("bone_3");
+	frozen_bones.push_back("bone_4");
+	ewbik->set_frozen_bones(frozen_bones);
+	ewbik->update_skeleton();
+	ewbik->solve(1.0);
+
+	for (int32_t bone_i = 3; bone_i <= 4; bone_i++) {
+		Transform local = skeleton->get_bone_global_pose(bone_i - 1).affine_inverse() * skeleton->get_bone_global_pose(bone_i);
+		CHECK(local.is_equal_approx(skeleton->get_bone_rest(bone_i)));
+	}
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Twist bones only roll around their axis") {
+	Skeleton3D *skeleton = create_chain_skeleton(6, 0.25);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(Vector3(0.0, 1.0, 0.0), 1.2), Vector3(0.4, 0.9, 0.3)));
+	ewbik->set_effector_use_node_rotation(0, true);
+	// Without a share the twist bone is only held rigid, which gives the reference pose.
+	ewbik->add_twist_bone("bone_2", "bone_4", 0.0);
+	ewbik->update_skeleton();
+	ewbik->solve(1.0);
+	Transform driver_global = skeleton->get_bone_global_pose(4);
+	Transform tip_global = skeleton->get_bone_global_pose(5);
+
+	ewbik->set_twist_bone_fraction(0, 0.5);
+	ewbik->update_skeleton();
+	ewbik->solve(1.0);
+
+	Transform local = skeleton->get_bone_global_pose(1).affine_inverse() * skeleton->get_bone_global_pose(2);
+	Basis roll = skeleton->get_bone_rest(2).basis.inverse() * local.basis;
+	CHECK(roll.get_axis(Vector3::AXIS_Y).is_equal_approx(Vector3(0.0, 1.0, 0.0)));
+	// Bent or not, the bones below the twist bone keep the pose solved without it.
+	CHECK(skeleton->get_bone_global_pose(4).is_equal_approx(driver_global));
+	CHECK(skeleton->get_bone_global_pose(5).is_equal_approx(tip_global));
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Weight threshold culls distant effector headings") {
+	Skeleton3D *skeleton = create_chain_skeleton(8, 0.25);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(0.5, 1.0, 0.5)));
+	ewbik->add_effector("bone_3", NodePath(), false, Transform(Basis(), Vector3(0.2, 0.7, 0.0)));
+	ewbik->set_effector_depth_falloff(1, 0.1);
+	ewbik->set_effector_weight_threshold(0.5);
+	ewbik->update_skeleton();
+
+	Dictionary report = ewbik->get_heading_report();
+	CHECK(Vector2i(report["bone_1"]) == Vector2i(4, 2));
+	CHECK(Vector2i(report["bone_6"]) == Vector2i(2, 2));
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Disabled effectors are skipped without a rebuild") {
+	Skeleton3D *skeleton = create_chain_skeleton(6, 0.25);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(0.5, 0.5, 0.5)));
+
+	ewbik->set_effector_enabled(0, false);
+	ewbik->solve(1.0);
+	CHECK(ewbik->get_last_iteration_count() == 0);
+	CHECK(skeleton->get_bone_global_pose(5).is_equal_approx(Transform(Basis(), Vector3(0.0, 1.25, 0.0))));
+
+	ewbik->set_effector_enabled(0, true);
+	ewbik->set_effector_weight(0, 0.5);
+	ewbik->solve(1.0);
+	CHECK(ewbik->get_last_iteration_count() > 0);
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Multi-rate effector holds its chain between updates") {
+	Skeleton3D *skeleton = create_chain_skeleton(6, 0.25);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(0.5, 0.5, 0.5)));
+	ewbik->set_effector_update_divider(0, 2);
+	ewbik->solve(1.0);
+	Transform solved = skeleton->get_bone_global_pose(5);
+
+	// The first frame after the full solve is an off frame, so the chain keeps its previous pose.
+	ewbik->set_effector_target_transform(0, Transform(Basis(), Vector3(-0.5, 0.5, 0.5)));
+	ewbik->solve(1.0);
+	CHECK(skeleton->get_bone_global_pose(5).is_equal_approx(solved));
+	ewbik->solve(1.0);
+	CHECK_FALSE(skeleton->get_bone_global_pose(5).is_equal_approx(solved));
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Out of reach targets skip the iterations") {
+	Skeleton3D *skeleton = create_chain_skeleton(6, 0.25);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(3.0, 0.0, 0.0)));
+	CHECK(Math::is_equal_approx(ewbik->get_effector_reach(0), real_t(1.25)));
+
+	ewbik->solve(1.0);
+	CHECK_FALSE(ewbik->is_effector_reachable(0));
+	CHECK_FALSE(ewbik->is_target_reachable());
+	CHECK_FALSE(ewbik->is_converged());
+	CHECK(ewbik->get_last_iteration_count() == 0);
+
+	ewbik->set_effector_target_transform(0, Transform(Basis(), Vector3(0.5, 0.5, 0.0)));
+	ewbik->solve(1.0);
+	CHECK(ewbik->is_effector_reachable(0));
+	CHECK(ewbik->is_target_reachable());
+	CHECK(ewbik->get_last_iteration_count() > 0);
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Iterations scale with blend strength") {
+	Skeleton3D *skeleton = create_chain_skeleton(10, 0.25);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(1.0, -0.5, 0.5)));
+	ewbik->set_ik_iterations(20);
+	ewbik->set_convergence_tolerance(0.0);
+	ewbik->set_scale_iterations_by_strength(true);
+
+	ewbik->solve(1.0);
+	CHECK(ewbik->get_last_iteration_count() == 20);
+	ewbik->set_effector_target_transform(0, Transform(Basis(), Vector3(-1.0, -0.5, 0.5)));
+	ewbik->solve(0.1);
+	CHECK(ewbik->get_last_iteration_count() == 2);
+
+	memdelete(skeleton);
+}
+
+void measure_solver_backend(int32_t p_backend, real_t &r_error, int32_t &r_iterations) {
+	Skeleton3D *skeleton = create_chain_skeleton(12, 0.2);
+	Vector3 target = Vector3(1.1, 1.2, -0.7);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), target));
+	ewbik->set_solver_backend(p_backend);
+	ewbik->set_ik_iterations(50);
+	ewbik->set_convergence_tolerance(0.001);
+
+	ewbik->solve(1.0);
+	r_iterations = ewbik->get_last_iteration_count();
+	r_error = skeleton->get_bone_global_pose(11).origin.distance_to(target);
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Solver backends reach the target") {
+	for (int32_t backend_i = 0; backend_i < IKSolverBackend::TYPE_MAX; backend_i++) {
+		real_t error = 0.0;
+		int32_t iterations = 0;
+		measure_solver_backend(backend_i, error, iterations);
+		CHECK(iterations > 0);
+		CHECK(iterations <= 50);
+		CHECK(error < 0.1);
+	}
+}
+
+BoneId add_rest_bone(Skeleton3D *p_skeleton, const String &p_name, BoneId p_parent, const Vector3 &p_offset) {
+	p_skeleton->add_bone(p_name);
+	BoneId bone = p_skeleton->get_bone_count() - 1;
+	p_skeleton->set_bone_parent(bone, p_parent);
+	p_skeleton->set_bone_rest(bone, Transform(Basis(), p_offset));
+	return bone;
+}
+
+Ref<SkeletonModification3DEWBIK> create_hands_modification(Skeleton3D *p_skeleton, int32_t p_finger_count) {
+	Vector<String> effector_bones;
+	Vector<Transform> targets;
+	p_skeleton->add_bone("root");
+	BoneId spine = add_rest_bone(p_skeleton, "spine", 0, Vector3(0.0, 0.5, 0.0));
+	for (int32_t side = -1; side <= 1; side += 2) {
+		String prefix = side < 0 ? "left_" : "right_";
+		BoneId bone = spine;
+		Vector3 origin = Vector3(0.0, 0.5, 0.0);
+		for (int32_t arm_i = 0; arm_i < 3; arm_i++) {
+			bone = add_rest_bone(p_skeleton, prefix + "arm_" + itos(arm_i), bone, Vector3(0.2 * side, 0.0, 0.0));
+			origin += Vector3(0.2 * side, 0.0, 0.0);
+		}
+		BoneId hand = add_rest_bone(p_skeleton, prefix + "hand", bone, Vector3(0.1 * side, 0.0, 0.0));
+		Vector3 hand_origin = origin + Vector3(0.1 * side, 0.0, 0.0);
+		for (int32_t finger_i = 0; finger_i < p_finger_count; finger_i++) {
+			bone = hand;
+			Vector3 finger_origin = hand_origin;
+			for (int32_t joint_i = 0; joint_i < 3; joint_i++) {
+				Vector3 offset = joint_i == 0 ? Vector3(0.05 * side, 0.0, (finger_i - p_finger_count / 2) * 0.02) : Vector3(0.03 * side, 0.0, 0.0);
+				bone = add_rest_bone(p_skeleton, prefix + "finger_" + itos(finger_i) + "_" + itos(joint_i), bone, offset);
+				finger_origin += offset;
+			}
+			effector_bones.push_back(p_skeleton->get_bone_name(bone));
+			targets.push_back(Transform(Basis(), finger_origin + Vector3(0.0, -0.04, 0.01)));
+		}
+		effector_bones.push_back(p_skeleton->get_bone_name(hand));
+		targets.push_back(Transform(Basis(), hand_origin + Vector3(0.0, -0.1, 0.1)));
+	}
+	return create_modification(p_skeleton, effector_bones, targets);
+}
+
+TEST_CASE("[Modules][EWBIK] Parallel finger subtrees") {
+	Skeleton3D *skeleton = memnew(Skeleton3D);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_hands_modification(skeleton, 5);
+	ewbik->set_ik_iterations(30);
+	ewbik->set_convergence_tolerance(0.0);
+
+	ewbik->solve(1.0);
+	Vector<Transform> serial_poses;
+	for (int32_t bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
+		serial_poses.push_back(skeleton->get_bone_global_pose(bone_i));
+	}
+
+	ewbik->set_parallel_solve(true);
+	ewbik->set_ik_iterations(30); // Forces a full solve again.
+	ewbik->solve(1.0);
+	for (int32_t bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
+		CHECK(skeleton->get_bone_global_pose(bone_i) == serial_poses[bone_i]);
+	}
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Moving one target only re-solves its own chain") {
+	Skeleton3D *skeleton = memnew(Skeleton3D);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_hands_modification(skeleton, 2);
+	ewbik->set_ik_iterations(20);
+	ewbik->set_convergence_tolerance(0.0);
+	ewbik->solve(1.0);
+	BoneId sibling_tip = skeleton->find_bone("left_finger_1_2");
+	Transform sibling_pose = skeleton->get_bone_global_pose(sibling_tip);
+
+	// Fingers have no depth falloff, so their headings stop at the hand and the siblings stay clean.
+	ewbik->set_effector_target_transform(0, ewbik->get_effector_target_transform(0) * Transform(Basis(), Vector3(0.0, -0.01, 0.0)));
+	ewbik->solve(1.0);
+	CHECK(ewbik->get_effector(0)->get_effector()->is_dirty());
+	CHECK_FALSE(ewbik->get_effector(1)->get_effector()->is_dirty());
+	CHECK(ewbik->get_last_iteration_count() > 0);
+	CHECK(skeleton->get_bone_global_pose(sibling_tip).is_equal_approx(sibling_pose));
+
+	memdelete(skeleton);
+}
+
+Ref<SkeletonModification3DEWBIK> create_roots_modification(Skeleton3D *p_skeleton, int32_t p_root_count) {
+	Vector<String> effector_bones;
+	Vector<Transform> targets;
+	for (int32_t root_i = 0; root_i < p_root_count; root_i++) {
+		p_skeleton->add_bone("root_" + itos(root_i));
+		BoneId bone = p_skeleton->get_bone_count() - 1;
+		p_skeleton->set_bone_rest(bone, Transform(Basis(), Vector3(root_i * 2.0, 0.0, 0.0)));
+		for (int32_t bone_i = 0; bone_i < 4; bone_i++) {
+			bone = add_rest_bone(p_skeleton, "bone_" + itos(root_i) + "_" + itos(bone_i), bone, Vector3(0.0, 0.25, 0.0));
+		}
+		effector_bones.push_back(p_skeleton->get_bone_name(bone));
+		targets.push_back(Transform(Basis(), Vector3(root_i * 2.0 + 0.5, 0.6, 0.3)));
+	}
+	return create_modification(p_skeleton, effector_bones, targets);
+}
+
+TEST_CASE("[Modules][EWBIK] Every root of a multi-root skeleton is solved") {
+	Skeleton3D *skeleton = memnew(Skeleton3D);
+	const int32_t root_count = 3;
+	Ref<SkeletonModification3DEWBIK> ewbik = create_roots_modification(skeleton, root_count);
+	ewbik->set_ik_iterations(20);
+	ewbik->set_convergence_tolerance(0.0);
+	CHECK(ewbik->get_root_count() == root_count);
+
+	ewbik->solve(1.0);
+	Vector<Transform> serial_poses;
+	for (int32_t bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
+		serial_poses.push_back(skeleton->get_bone_global_pose(bone_i));
+	}
+	for (int32_t effector_i = 0; effector_i < root_count; effector_i++) {
+		CHECK(ewbik->get_effector(effector_i)->get_effector()->get_error() < 0.1);
+	}
+
+	ewbik->set_parallel_solve(true);
+	ewbik->set_ik_iterations(20); // Forces a full solve again.
+	ewbik->solve(1.0);
+	for (int32_t bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
+		CHECK(skeleton->get_bone_global_pose(bone_i) == serial_poses[bone_i]);
+	}
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Effector passes follow error and budget") {
+	Skeleton3D *skeleton = memnew(Skeleton3D);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_roots_modification(skeleton, 3);
+	ewbik->set_ik_iterations(1);
+	ewbik->set_stabilization_passes(0);
+	ewbik->set_convergence_tolerance(0.0);
+	// The first effector is far from its target, the second one close, the third one has no budget.
+	ewbik->set_effector_target_transform(0, Transform(Basis(), Vector3(0.7, 0.5, 0.3)));
+	ewbik->set_effector_target_transform(1, Transform(Basis(), Vector3(2.05, 0.95, 0.05)));
+	ewbik->set_effector_budget(2, 0.0);
+	BoneId skipped_tip = skeleton->find_bone("bone_2_3");
+	Transform skipped_rest = skeleton->get_bone_global_pose(skipped_tip);
+
+	ewbik->solve(1.0);
+	int32_t far_passes = ewbik->get_effector(0)->get_effector()->get_scheduled_passes();
+	int32_t near_passes = ewbik->get_effector(1)->get_effector()->get_scheduled_passes();
+	CHECK(far_passes > near_passes);
+	CHECK(ewbik->get_effector(2)->get_effector()->get_scheduled_passes() == 0);
+	CHECK(skeleton->get_bone_global_pose(skipped_tip).is_equal_approx(skipped_rest));
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Moving an ancestor of the root bone triggers a solve") {
+	Skeleton3D *skeleton = create_chain_skeleton(12, 0.2);
+	Vector3 target = Vector3(0.6, 1.2, 0.4);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), target));
+	ewbik->set_root_bone("bone_2");
+	ewbik->set_ik_iterations(30);
+	ewbik->set_convergence_tolerance(0.001);
+	BoneId tip = skeleton->get_bone_count() - 1;
+	ewbik->execute(1.0 / 60.0);
+	CHECK(skeleton->get_bone_global_pose(tip).origin.distance_to(target) < 0.05);
+
+	// Only bone_1 moves, which is above the solved bones, so none of their own poses change.
+	skeleton->set_bone_pose(1, Transform(Basis(Vector3(0.0, 0.0, 1.0), 0.3), Vector3()));
+	ewbik->execute(1.0 / 60.0);
+	CHECK(skeleton->get_bone_global_pose(tip).origin.distance_to(target) < 0.05);
+
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Level of detail cuts the iterations of a crowd") {
+	const int32_t crowd_size = 32;
+	const int32_t frame_count = 12;
+	Vector<Skeleton3D *> skeletons;
+	Vector<Ref<SkeletonModification3DEWBIK>> crowd;
+	for (int32_t character_i = 0; character_i < crowd_size; character_i++) {
+		Skeleton3D *skeleton = create_chain_skeleton(12, 0.2);
+		Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform());
+		ewbik->set_ik_iterations(20);
+		ewbik->set_convergence_tolerance(0.0);
+		skeletons.push_back(skeleton);
+		crowd.push_back(ewbik);
+	}
+
+	int32_t total_iterations[2] = {};
+	for (int32_t mode = 0; mode < 2; mode++) {
+		for (int32_t character_i = 0; character_i < crowd_size; character_i++) {
+			// With level of detail a quarter of the crowd is off-screen, the rest spread over the importance range.
+			crowd.write[character_i]->set_lod_importance(mode == 1 ? real_t(character_i % 4) / 3.0 : 1.0);
+			crowd.write[character_i]->set_lod_max_frame_skip(mode == 1 ? 3 : 0);
+		}
+		for (int32_t frame = 0; frame < frame_count; frame++) {
+			for (int32_t character_i = 0; character_i < crowd_size; character_i++) {
+				crowd.write[character_i]->set_effector_target_transform(0, Transform(Basis(), Vector3(1.0, -0.5, frame * 0.02)));
+				crowd.write[character_i]->execute(1.0 / 60.0);
+				total_iterations[mode] += crowd[character_i]->get_last_iteration_count();
+			}
+		}
+	}
+
+	// Characters 1 and 3 have an importance of a third and of one.
+	CHECK(crowd[1]->get_last_iteration_count() < crowd[3]->get_last_iteration_count());
+	CHECK(total_iterations[1] < total_iterations[0]);
+
+	for (int32_t character_i = 0; character_i < crowd_size; character_i++) {
+		memdelete(skeletons[character_i]);
+	}
+}
+
+TEST_CASE("[Modules][EWBIK] Server batches the solves of a crowd") {
+	const int32_t crowd_size = 16;
+	EWBIKServer *server = EWBIKServer::get_singleton();
+	bool own_server = !server;
+	if (own_server) {
+		server = memnew(EWBIKServer);
+	}
+	Vector<Skeleton3D *> skeletons;
+	Vector<Ref<SkeletonModification3DEWBIK>> crowd;
+	for (int32_t character_i = 0; character_i < crowd_size * 2; character_i++) {
+		Skeleton3D *skeleton = create_chain_skeleton(12, 0.2);
+		Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, Transform(Basis(), Vector3(1.0, -0.5, 0.5)));
+		ewbik->set_ik_iterations(20);
+		ewbik->set_convergence_tolerance(0.0);
+		// The second half of the crowd is solved by the server.
+		ewbik->set_server_solve(character_i >= crowd_size);
+		skeletons.push_back(skeleton);
+		crowd.push_back(ewbik);
+	}
+
+	for (int32_t character_i = 0; character_i < crowd_size; character_i++) {
+		crowd.write[character_i]->execute(1.0 / 60.0);
+	}
+	for (int32_t character_i = crowd_size; character_i < crowd_size * 2; character_i++) {
+		crowd.write[character_i]->execute(1.0 / 60.0);
+	}
+	server->solve_batch();
+
+	CHECK(server->get_last_batch_size() == crowd_size);
+	for (int32_t character_i = 0; character_i < crowd_size; character_i++) {
+		Skeleton3D *serial = skeletons[character_i];
+		Skeleton3D *batched = skeletons[character_i + crowd_size];
+		for (int32_t bone_i = 0; bone_i < serial->get_bone_count(); bone_i++) {
+			CHECK(batched->get_bone_global_pose(bone_i) == serial->get_bone_global_pose(bone_i));
+		}
+	}
+
+	for (int32_t character_i = 0; character_i < crowd_size * 2; character_i++) {
+		crowd.write[character_i]->set_server_solve(false);
+		memdelete(skeletons[character_i]);
+	}
+	if (own_server) {
+		memdelete(server);
+	}
+}
+
+TEST_CASE("[Modules][EWBIK] Server solves before the rest of the stack") {
+	EWBIKServer *server = EWBIKServer::get_singleton();
+	bool own_server = !server;
+	if (own_server) {
+		server = memnew(EWBIKServer);
+	}
+	Transform target = Transform(Basis(), Vector3(1.0, -0.5, 0.5));
+	Skeleton3D *reference_skeleton = create_chain_skeleton(12, 0.2);
+	Ref<SkeletonModification3DEWBIK> reference_ewbik = create_chain_modification(reference_skeleton, target);
+	reference_ewbik->execute(1.0 / 60.0);
+
+	Skeleton3D *skeleton = create_chain_skeleton(12, 0.2);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, target);
+	ewbik->set_server_solve(true);
+	// Anything after EWBIK reads its pose, so the batch can't wait until the stacks are done.
+	Ref<SkeletonModification3D> later;
+	later.instance();
+	skeleton->get_modification_stack()->add_modification(later);
+	ewbik->execute(1.0 / 60.0);
+
+	CHECK(server->get_last_batch_size() == 1);
+	for (int32_t bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
+		CHECK(skeleton->get_bone_global_pose(bone_i) == reference_skeleton->get_bone_global_pose(bone_i));
+	}
+
+	ewbik->set_server_solve(false);
+	memdelete(reference_skeleton);
+	memdelete(skeleton);
+	if (own_server) {
+		memdelete(server);
+	}
+}
+
+TEST_CASE("[Modules][EWBIK] Asynchronous solve applies the result one frame later") {
+	Transform target = Transform(Basis(), Vector3(1.0, -0.5, 0.5));
+	Skeleton3D *sync_skeleton = create_chain_skeleton(12, 0.2);
+	Ref<SkeletonModification3DEWBIK> sync_ewbik = create_chain_modification(sync_skeleton, target);
+	Skeleton3D *async_skeleton = create_chain_skeleton(12, 0.2);
+	Ref<SkeletonModification3DEWBIK> async_ewbik = create_chain_modification(async_skeleton, target);
+	async_ewbik->set_async_solve(true);
+	BoneId tip = async_skeleton->get_bone_count() - 1;
+	Transform rest_tip = async_skeleton->get_bone_global_pose(tip);
+
+	sync_ewbik->execute(1.0 / 60.0);
+	async_ewbik->execute(1.0 / 60.0);
+	CHECK(async_skeleton->get_bone_global_pose(tip) == rest_tip);
+
+	async_ewbik->execute(1.0 / 60.0);
+	for (int32_t bone_i = 0; bone_i < async_skeleton->get_bone_count(); bone_i++) {
+		CHECK(async_skeleton->get_bone_global_pose(bone_i) == sync_skeleton->get_bone_global_pose(bone_i));
+	}
+
+	memdelete(sync_skeleton);
+	memdelete(async_skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Solve between gather and scatter only sees the snapshot") {
+	Transform target = Transform(Basis(), Vector3(1.0, -0.5, 0.5));
+	Skeleton3D *reference_skeleton = create_chain_skeleton(12, 0.2);
+	Ref<SkeletonModification3DEWBIK> reference_ewbik = create_chain_modification(reference_skeleton, target);
+	reference_ewbik->solve(1.0);
+
+	Skeleton3D *skeleton = create_chain_skeleton(12, 0.2);
+	Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, target);
+	REQUIRE(ewbik->gather_solve(1.0));
+	// Edits between gather and scatter must not leak into the solve.
+	skeleton->set_bone_pose(3, Transform(Basis(Vector3(0.0, 0.0, 1.0), 1.0), Vector3()));
+	ewbik->solve_gathered();
+	skeleton->set_bone_pose(3, Transform());
+	ewbik->scatter_solve(true);
+
+	for (int32_t bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
+		CHECK(skeleton->get_bone_global_pose(bone_i) == reference_skeleton->get_bone_global_pose(bone_i));
+	}
+
+	memdelete(reference_skeleton);
+	memdelete(skeleton);
+}
+
+TEST_CASE("[Modules][EWBIK] Work stealing across uneven rigs") {
+	EWBIKServer *server = EWBIKServer::get_singleton();
+	bool own_server = !server;
+	if (own_server) {
+		server = memnew(EWBIKServer);
+	}
+	IKTaskScheduler *scheduler = IKTaskScheduler::get_singleton();
+	bool own_scheduler = !scheduler;
+	if (own_scheduler) {
+		scheduler = memnew(IKTaskScheduler(OS::get_singleton()->get_processor_count()));
+	}
+	// Two heroes with ten fingers each among a handful of single chain extras.
+	const int32_t hero_count = 2;
+	const int32_t extra_count = 8;
+	Vector<Skeleton3D *> skeletons;
+	Vector<Ref<SkeletonModification3DEWBIK>> rigs;
+	for (int32_t copy = 0; copy < 2; copy++) {
+		for (int32_t rig_i = 0; rig_i < hero_count + extra_count; rig_i++) {
+			Skeleton3D *skeleton = rig_i < hero_count ? memnew(Skeleton3D) : create_chain_skeleton(8, 0.2);
+			Ref<SkeletonModification3DEWBIK> ewbik = rig_i < hero_count ? create_hands_modification(skeleton, 5) : create_chain_modification(skeleton, Transform(Basis(), Vector3(0.6, 0.8, 0.3)));
+			ewbik->set_ik_iterations(20);
+			ewbik->set_convergence_tolerance(0.0);
+			// The first copy solves one rig at a time and serially as the reference.
+			ewbik->set_parallel_solve(copy == 1);
+			ewbik->set_server_solve(copy == 1);
+			skeletons.push_back(skeleton);
+			rigs.push_back(ewbik);
+		}
+	}
+
+	const int32_t rig_count = hero_count + extra_count;
+	for (int32_t rig_i = 0; rig_i < rig_count; rig_i++) {
+		rigs.write[rig_i]->solve(1.0);
+		rigs.write[rig_i + rig_count]->execute(1.0 / 60.0);
+	}
+	server->solve_batch();
+
+	CHECK(server->get_last_batch_task_count() > rig_count);
+	CHECK(server->get_last_batch_utilization() <= 1.0 + CMP_EPSILON);
+	CHECK(server->get_last_batch_critical_path_millisecond() <= server->get_last_batch_millisecond() + CMP_EPSILON);
+	for (int32_t rig_i = 0; rig_i < rig_count; rig_i++) {
+		Skeleton3D *serial = skeletons[rig_i];
+		Skeleton3D *batched = skeletons[rig_i + rig_count];
+		for (int32_t bone_i = 0; bone_i < serial->get_bone_count(); bone_i++) {
+			CHECK(batched->get_bone_global_pose(bone_i) == serial->get_bone_global_pose(bone_i));
+		}
+	}
+
+	for (int32_t rig_i = 0; rig_i < rigs.size(); rig_i++) {
+		rigs.write[rig_i]->set_server_solve(false);
+		memdelete(skeletons[rig_i]);
+	}
+	if (own_server) {
+		memdelete(server);
+	}
+	if (own_scheduler) {
+		memdelete(scheduler);
+	}
+}
+
+void record_thread(void *p_ids, uint32_t p_index) {
+	((Thread::ID *)p_ids)[p_index] = Thread::get_caller_id();
+}
+
+TEST_CASE("[Modules][EWBIK] Waiting on a graph leaves other tasks to the workers") {
+	IKTaskScheduler *scheduler = IKTaskScheduler::get_singleton();
+	bool own_scheduler = !scheduler;
+	if (own_scheduler) {
+		scheduler = memnew(IKTaskScheduler(MAX(OS::get_singleton()->get_processor_count(), 2)));
+	}
+	Thread::ID async_id = Thread::ID();
+	IKTaskScheduler::AsyncTask async_task;
+	scheduler->submit(async_task, record_thread, &async_id);
+	const int32_t task_count = 64;
+	Thread::ID graph_ids[task_count];
+	scheduler->run(record_thread, graph_ids, task_count);
+	IKTaskScheduler::wait(async_task);
+
+	// The asynchronous task was queued first, but the caller only helps with its own graph.
+	CHECK(async_id != Thread::ID());
+	CHECK(async_id != Thread::get_caller_id());
+
+	if (own_scheduler) {
+		memdelete(scheduler);
+	}
+}
+
+TEST_CASE("[Modules][EWBIK] QCP lanes match the scalar QCP") {
+	const int32_t count = 6;
+	QCPLanes::Heading tips[count];
+	QCPLanes::Heading targets[count];
+	QCPLanes::Weight weights[count];
+	memset(tips, 0, sizeof(tips));
+	memset(targets, 0, sizeof(targets));
+	memset(weights, 0, sizeof(weights));
+	PackedVector3Array lane_tips[QCPLanes::LANES];
+	PackedVector3Array lane_targets[QCPLanes::LANES];
+	Vector<real_t> lane_weights[QCPLanes::LANES];
+	// The third lane stays zeroed and out of the mask, it must not disturb the others.
+	const uint32_t mask = 0b1011;
+	for (int32_t lane = 0; lane < QCPLanes::LANES; lane++) {
+		if (!(mask & (1 << lane))) {
+			continue;
+		}
+		Basis rotation = Basis(Vector3(0.3, 1.0, -0.2 * lane).normalized(), 0.2 + 0.4 * lane);
+		for (int32_t i = 0; i < count; i++) {
+			Vector3 tip = Vector3(Math::sin(1.3 * i + lane), Math::cos(0.7 * i), 0.5 - 0.2 * i);
+			// Slightly off the exact rotation, so the fit has some error to minimize.
+			Vector3 target = rotation.xform(tip) + Vector3(0.01 * i, -0.02 * lane, 0.0);
+			real_t weight = 1.0 + 0.5 * i;
+			tips[i].x[lane] = tip.x;
+			tips[i].y[lane] = tip.y;
+			tips[i].z[lane] = tip.z;
+			targets[i].x[lane] = target.x;
+			targets[i].y[lane] = target.y;
+			targets[i].z[lane] = target.z;
+			weights[i].w[lane] = weight;
+			lane_tips[lane].push_back(tip);
+			lane_targets[lane].push_back(target);
+			lane_weights[lane].push_back(weight);
+		}
+	}
+
+	QCPLanes lanes;
+	Quat lane_rots[QCPLanes::LANES];
+	lanes.calc_optimal_rotations(tips, targets, weights, count, mask, lane_rots);
+	for (int32_t lane = 0; lane < QCPLanes::LANES; lane++) {
+		if (!(mask & (1 << lane))) {
+			continue;
+		}
+		QCP qcp;
+		Quat rot;
+		qcp.calc_optimal_rotation(lane_tips[lane], lane_targets[lane], lane_weights[lane], rot);
+		// Both signs describe the same rotation.
+		CHECK(Math::is_equal_approx(Math::abs(lane_rots[lane].dot(rot)), real_t(1.0)));
+	}
+}
+
+TEST_CASE("[Modules][EWBIK] Crowd rigs solve together in lanes") {
+	EWBIKServer *server = EWBIKServer::get_singleton();
+	bool own_server = !server;
+	if (own_server) {
+		server = memnew(EWBIKServer);
+	}
+	const int32_t crowd_size = QCPLanes::LANES * 2;
+	Vector<Skeleton3D *> skeletons;
+	Vector<Ref<SkeletonModification3DEWBIK>> crowd;
+	for (int32_t copy = 0; copy < 2; copy++) {
+		for (int32_t character_i = 0; character_i < crowd_size; character_i++) {
+			Skeleton3D *skeleton = create_chain_skeleton(12, 0.2);
+			// Same rig everywhere, but every character reaches for a target of its own.
+			Transform target = Transform(Basis(), Vector3(1.0 - 0.1 * character_i, -0.5, 0.2 + 0.05 * character_i));
+			Ref<SkeletonModification3DEWBIK> ewbik = create_chain_modification(skeleton, target);
+			ewbik->set_ik_iterations(20);
+			ewbik->set_stabilization_passes(0);
+			ewbik->set_convergence_tolerance(0.001);
+			// Both copies go through the server batch, the first one with the scalar solve as the reference.
+			ewbik->set_server_solve(true);
+			ewbik->set_crowd_solve(copy == 1);
+			skeletons.push_back(skeleton);
+			crowd.push_back(ewbik);
+		}
+	}
+
+	for (int32_t character_i = 0; character_i < crowd_size; character_i++) {
+		crowd.write[character_i]->execute(1.0 / 60.0);
+	}
+	server->solve_batch();
+	CHECK(server->get_last_batch_pack_count() == crowd_size);
+	for (int32_t character_i = crowd_size; character_i < crowd_size * 2; character_i++) {
+		crowd.write[character_i]->execute(1.0 / 60.0);
+	}
+	server->solve_batch();
+
+	CHECK(crowd[crowd_size]->is_crowd_packable());
+	CHECK(server->get_last_batch_pack_count() == crowd_size / QCPLanes::LANES);
+	for (int32_t character_i = 0; character_i < crowd_size; character_i++) {
+		Skeleton3D *serial = skeletons[character_i];
+		Skeleton3D *packed = skeletons[character_i + crowd_size];
+		for (int32_t bone_i = 0; bone_i < serial->get_bone_count(); bone_i++) {
+			CHECK(packed->get_bone_global_pose(bone_i).is_equal_approx(serial->get_bone_global_pose(bone_i)));
+		}
+	}
+
+	for (int32_t character_i = 0; character_i < crowd.size(); character_i++) {
+		crowd.write[character_i]->set_server_solve(false);
+		memdelete(skeletons[character_i]);
+	}
+	if (own_server) {
+		memdelete(server);
+	}
 }
 } // namespace TestEWBIK
 